@@ -0,0 +1,353 @@
+/*
+ * osm2mobsink benchmarks.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times a conversion of a synthetic (or given) map and a few geometry
+ * micro-benchmarks, and prints the results as JSON:
+ *
+ *   osm2mobsink-bench [--nodes N] [--way-length N] [--highways F]
+ *                     [--names F] [--oneways F] [--maxspeeds F]
+ *                     [--outside F] [--seed N] [--threads N]
+ *                     [--iterations N] [--input FILE] [--keep FILE]
+ *                     [--output FILE] [--format xml|bin] [--rules FILE]
+ *                     [--simplify T] [--two-pass 0|1] [--stats FILE]
+ *
+ * The map is converted by Converter, as the command line does it: the
+ * OSM reader, the tag rules, the network builder and the network writer
+ * of the product all run, and the phases are the ones timed by its
+ * ConversionStats (read, and references, simplify or finish when they
+ * run). The generated map is written to the --keep file, or to
+ * osm2mobsink-bench.osm, and the network to the --output file, or to
+ * osm2mobsink-bench.out; the files that weren't asked for are removed.
+ * Only the JSON goes to the standard output: the summaries printed by
+ * the conversion (like the one of --simplify) go to the standard error,
+ * with the errors. The network is then read back, and the benchmark
+ * fails if an end of a path lies outside of it; run it with
+ * --input sample.osm to check the sample map.
+ * It is built by the Benchmark configuration of the project.
+ */
+
+#include "OSMGenerator.h"
+#include <Converter.h>
+#include <ConversionStats.h>
+#include <MobSinkBinary.h>
+#include <MobSinkReader.h>
+#include <Path.h>
+#include <Point.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Names of the files that weren't asked for
+#define BENCH_MAP_FILE "osm2mobsink-bench.osm"
+#define BENCH_OUTPUT_FILE "osm2mobsink-bench.out"
+
+// Size of a file in bytes (0 if it can't be opened)
+static double GetFileSize(const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (!fp)
+		return 0;
+
+	fseek(fp, 0, SEEK_END);
+	double size = ftell(fp);
+	fclose(fp);
+	return size;
+}
+
+// Count the ends of the paths of a network (XML or binary) that lie
+// outside of it. Returns false if the network can't be read.
+static bool CountOutside(const char *filename, unsigned long long &outside)
+{
+	MobSinkBinaryFile file;
+	MobSinkBinaryReader binary;
+	MobSinkReader xml;
+	vector<float> ends;
+	double width, height;
+
+	outside = 0;
+	if (!file.Open(filename))
+		return false;
+
+	if (binary.Open(file.GetData(), file.GetSize()))
+	{
+		const mobsinkbin_header *header = binary.GetHeader();
+		const mobsinkbin_path *paths = binary.GetPaths();
+		width = header->width;
+		height = header->height;
+
+		for (uint64_t i = 0; i < header->path_count; i++)
+			ends.insert(ends.end(), { paths[i].xa, paths[i].ya, paths[i].xb, paths[i].yb });
+	}
+	else if (xml.Open((const char *)file.GetData(), file.GetSize()))
+	{
+		Path path;
+		width = xml.width;
+		height = xml.height;
+
+		while (xml.Next(path))
+		{
+			ends.insert(ends.end(), { path.GetPointA().GetX(), path.GetPointA().GetY(),
+									  path.GetPointB().GetX(), path.GetPointB().GetY() });
+		}
+
+		if (!xml.IsOk())
+			return false;
+	}
+	else
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < ends.size(); i += 2)
+	{
+		if ((ends[i] < 0) || (ends[i] > width) || (ends[i + 1] < 0) || (ends[i + 1] > height))
+			outside++;
+	}
+
+	return true;
+}
+
+// Time a geometry operation over random inputs (nanoseconds per call)
+static double RunMicro(int operation, unsigned long iterations, float &sink)
+{
+	const unsigned int count = 4096;
+	vector<Path> paths;
+	vector<Point> points;
+	uint64_t state = 12345;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float v[6];
+		for (unsigned int j = 0; j < 6; j++)
+		{
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			v[j] = (state >> 40) * (1000.0f / 16777216.0f);
+		}
+		paths.push_back(Path(v[0], v[1], v[2], v[3]));
+		points.push_back(Point(v[4], v[5]));
+	}
+
+	double start = ConversionStats::GetWallTime();
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		unsigned int k = i % count;
+		if (operation == 0)
+		{
+			sink += points[k].Distance(points[(k + 1) % count]);
+		}
+		else if (operation == 1)
+		{
+			sink += paths[k].GetProjection(points[k]).GetX();
+		}
+		else
+		{
+			bool exist;
+			sink += paths[k].GetIntersection(paths[(k + 1) % count], exist).GetY();
+		}
+	}
+
+	return iterations > 0 ? (ConversionStats::GetWallTime() - start) * 1e9 / iterations : 0;
+}
+
+int main(int argc, char **argv)
+{
+	osmgen_params params = OSMGenerator::GetDefaults();
+	Converter converter;
+	unsigned int threads = 1;
+	unsigned long iterations = 10000000;
+	const char *input = NULL;
+	const char *keep = NULL;
+	const char *output = NULL;
+
+	// Command line
+	for (int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (!value)
+		{
+			fprintf(stderr, "Missing value for %s. See the top of bench/Benchmark.cpp for the options.\n", arg);
+			return 1;
+		}
+
+		if (!strcmp(arg, "--nodes"))
+			params.nodes = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--way-length"))
+			params.way_length = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--highways"))
+			params.highways = atof(value);
+		else if (!strcmp(arg, "--names"))
+			params.names = atof(value);
+		else if (!strcmp(arg, "--oneways"))
+			params.oneways = atof(value);
+		else if (!strcmp(arg, "--maxspeeds"))
+			params.maxspeeds = atof(value);
+		else if (!strcmp(arg, "--outside"))
+			params.outside = atof(value);
+		else if (!strcmp(arg, "--seed"))
+			params.seed = strtoull(value, NULL, 10);
+		else if (!strcmp(arg, "--threads"))
+			threads = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--iterations"))
+			iterations = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--input"))
+			input = value;
+		else if (!strcmp(arg, "--keep"))
+			keep = value;
+		else if (!strcmp(arg, "--output"))
+			output = value;
+		else if (!strcmp(arg, "--format") && (!strcmp(value, "xml") || !strcmp(value, "bin")))
+			converter.options.format = strcmp(value, "bin") ? OUTPUT_XML : OUTPUT_BIN;
+		else if (!strcmp(arg, "--rules"))
+		{
+			if (!converter.rules.Load(value))
+				return 1;
+		}
+		else if (!strcmp(arg, "--simplify"))
+			converter.tolerance = atof(value);
+		else if (!strcmp(arg, "--two-pass"))
+			converter.twopass = atoi(value) != 0;
+		else if (!strcmp(arg, "--stats"))
+			converter.statsfile = value;
+		else
+		{
+			fprintf(stderr, "Unknown option %s (or value %s). See the top of bench/Benchmark.cpp for the options.\n", arg, value);
+			return 1;
+		}
+
+		i++;
+	}
+
+	// Generate the map (unless one was given)
+	const char *mapfile = input ? input : (keep ? keep : BENCH_MAP_FILE);
+	double generate_time = 0;
+
+	if (!input)
+	{
+		FILE *fp = fopen(mapfile, "wb");
+		if (!fp)
+		{
+			fprintf(stderr, "Could not open the map file.\n");
+			return 1;
+		}
+
+		double start = ConversionStats::GetWallTime();
+		OSMGenerator generator(params);
+		bool written = generator.Write(fp);
+		written = (fclose(fp) == 0) && written;
+		generate_time = ConversionStats::GetWallTime() - start;
+
+		if (!written)
+		{
+			fprintf(stderr, "Could not write the map file.\n");
+			return 1;
+		}
+	}
+
+	double input_size = GetFileSize(mapfile);
+
+	// Convert it
+	converter.inputfile = mapfile;
+	converter.outputfile = output ? output : BENCH_OUTPUT_FILE;
+	converter.threads = threads;
+	converter.options.threads = threads;
+	converter.messages = stderr;
+
+	bool ok = converter.Run();
+	double output_size = GetFileSize(converter.outputfile.c_str());
+
+	unsigned long long outside = 0;
+	bool checked = ok && CountOutside(converter.outputfile.c_str(), outside);
+
+	if (!input && !keep)
+		remove(mapfile);
+
+	if (!output)
+		remove(converter.outputfile.c_str());
+
+	if (!ok)
+	{
+		fprintf(stderr, "The map could not be converted.\n");
+		return 1;
+	}
+
+	if (!checked)
+	{
+		fprintf(stderr, "The network could not be read back.\n");
+		return 1;
+	}
+
+	// Micro-benchmarks
+	float sink = 0;
+	double distance_ns = RunMicro(0, iterations, sink);
+	double projection_ns = RunMicro(1, iterations, sink);
+	double intersection_ns = RunMicro(2, iterations, sink);
+
+	// Report
+	ConversionStats &stats = converter.stats;
+	stats_counters &counters = stats.counters;
+	double total = 0;
+
+	printf("{\n");
+	printf("  \"input\": { \"file\": \"%s\", \"bytes\": %.0f, \"nodes\": %llu, \"ways\": %llu, \"highways\": %llu },\n",
+		   ConversionStats::Escape(input || keep ? mapfile : "").c_str(), input_size, counters.nodes_read, counters.ways_read, counters.highways);
+	printf("  \"phases\": {\n");
+	printf("    \"generate\": { \"seconds\": %.6f, \"bytes_per_second\": %.1f },\n",
+		   generate_time, generate_time > 0 ? input_size / generate_time : 0);
+
+	for (int i = 0; i < STATS_PHASES; i++)
+	{
+		stats_phase phase = (stats_phase)i;
+		if (!stats.IsRun(phase))
+			continue;
+
+		printf("    \"%s\": { \"seconds\": %.6f, \"cpu_seconds\": %.6f },\n", ConversionStats::GetPhaseName(phase),
+			   stats.GetWallSeconds(phase), stats.GetCPUSeconds(phase));
+		total += stats.GetWallSeconds(phase);
+	}
+
+	printf("    \"total\": { \"seconds\": %.6f, \"bytes_per_second\": %.1f, \"paths_per_second\": %.1f }\n",
+		   total, total > 0 ? input_size / total : 0, total > 0 ? counters.paths / total : 0);
+	printf("  },\n");
+	printf("  \"output\": { \"file\": \"%s\", \"paths\": %llu, \"bytes\": %.0f, \"ends_outside\": %llu },\n",
+		   ConversionStats::Escape(output ? output : "").c_str(), counters.paths, output_size, outside);
+	printf("  \"micro\": {\n");
+	printf("    \"point_distance_ns\": %.3f,\n", distance_ns);
+	printf("    \"path_projection_ns\": %.3f,\n", projection_ns);
+	printf("    \"path_intersection_ns\": %.3f,\n", intersection_ns);
+	printf("    \"iterations\": %lu,\n", iterations);
+	printf("    \"checksum\": %g\n", sink);
+	printf("  },\n");
+	printf("  \"peak_memory_bytes\": %llu,\n", ConversionStats::GetPeakMemory());
+	printf("  \"ok\": %s\n", outside == 0 ? "true" : "false");
+	printf("}\n");
+
+	if (outside > 0)
+	{
+		fprintf(stderr, "%llu path ends lie outside the network.\n", outside);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Synthetic OpenStreetMap XML generator.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "OSMGenerator.h"
+#include <math.h>
+
+// Map boundaries (about 11 x 11 km)
+#define OSMGEN_MINLAT -12.9800
+#define OSMGEN_MINLON -38.5200
+#define OSMGEN_SIZE 0.1
+
+static const char *highway_types[] = { "residential", "primary", "secondary", "tertiary", "service" };
+static const char *other_tags[][2] = { { "building", "yes" }, { "waterway", "stream" }, { "landuse", "grass" } };
+
+// Constructor
+OSMGenerator::OSMGenerator(const osmgen_params &params)
+{
+	this->params = params;
+	this->state = params.seed ? params.seed : 1;
+	this->ways = 0;
+}
+
+// Default map: one million nodes, short ways, mostly highways
+osmgen_params OSMGenerator::GetDefaults(void)
+{
+	osmgen_params params;
+	params.nodes = 1000000;
+	params.way_length = 8;
+	params.highways = 0.7;
+	params.names = 0.5;
+	params.oneways = 0.2;
+	params.maxspeeds = 0.3;
+	params.outside = 0.05;
+	params.seed = 1;
+	return params;
+}
+
+// Write the map
+bool OSMGenerator::Write(FILE *fp)
+{
+	unsigned long side = ceil(sqrt((double)this->params.nodes));
+	double step = OSMGEN_SIZE / (side > 1 ? side : 1);
+
+	fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	fprintf(fp, "<osm version=\"0.6\" generator=\"osm2mobsink-bench\">\n");
+	fprintf(fp, " <bounds minlat=\"%.7f\" minlon=\"%.7f\" maxlat=\"%.7f\" maxlon=\"%.7f\"/>\n",
+			OSMGEN_MINLAT, OSMGEN_MINLON, OSMGEN_MINLAT + OSMGEN_SIZE, OSMGEN_MINLON + OSMGEN_SIZE);
+
+	// Nodes on a jittered grid. Some are pushed out of the boundaries.
+	for (unsigned long i = 0; i < this->params.nodes; i++)
+	{
+		double lat = OSMGEN_MINLAT + ((i / side) + 0.1 + 0.8 * NextDouble()) * step;
+		double lon = OSMGEN_MINLON + ((i % side) + 0.1 + 0.8 * NextDouble()) * step;
+
+		if (NextDouble() < this->params.outside)
+			lat += OSMGEN_SIZE;
+
+		fprintf(fp, " <node id=\"%lu\" visible=\"true\" version=\"1\" lat=\"%.7f\" lon=\"%.7f\"/>\n", i + 1, lat, lon);
+	}
+
+	// Ways walking over the grid
+	unsigned long count = this->params.way_length > 1 ? this->params.nodes / (this->params.way_length - 1) : 0;
+	for (this->ways = 0; this->ways < count; this->ways++)
+	{
+		fprintf(fp, " <way id=\"%lu\" visible=\"true\" version=\"1\">\n", this->ways + 1);
+
+		unsigned long node = Next() % this->params.nodes;
+		for (unsigned int n = 0; n < this->params.way_length; n++)
+		{
+			fprintf(fp, "  <nd ref=\"%lu\"/>\n", node + 1);
+
+			// Move to a neighbour, staying inside the grid
+			unsigned long row = node / side, column = node % side;
+			switch (Next() % 4)
+			{
+			case 0: row = row + 1 < side ? row + 1 : row - 1; break;
+			case 1: row = row > 0 ? row - 1 : row + 1; break;
+			case 2: column = column + 1 < side ? column + 1 : column - 1; break;
+			default: column = column > 0 ? column - 1 : column + 1; break;
+			}
+
+			if (row * side + column < this->params.nodes)
+				node = row * side + column;
+		}
+
+		if (NextDouble() < this->params.highways)
+		{
+			fprintf(fp, "  <tag k=\"highway\" v=\"%s\"/>\n", highway_types[Next() % 5]);
+
+			if (NextDouble() < this->params.names)
+				fprintf(fp, "  <tag k=\"name\" v=\"Rua %lu &amp; Travessa\"/>\n", (unsigned long)(Next() % 10000));
+
+			if (NextDouble() < this->params.oneways)
+				fprintf(fp, "  <tag k=\"oneway\" v=\"yes\"/>\n");
+
+			if (NextDouble() < this->params.maxspeeds)
+				fprintf(fp, "  <tag k=\"maxspeed\" v=\"%u\"/>\n", (unsigned int)(30 + 10 * (Next() % 8)));
+		}
+		else
+		{
+			unsigned int tag = Next() % 3;
+			fprintf(fp, "  <tag k=\"%s\" v=\"%s\"/>\n", other_tags[tag][0], other_tags[tag][1]);
+		}
+
+		fprintf(fp, " </way>\n");
+	}
+
+	fprintf(fp, "</osm>\n");
+	return !ferror(fp);
+}
+
+// Return the number of ways written
+unsigned long OSMGenerator::GetWays(void)
+{
+	return this->ways;
+}
+
+// xorshift64* random numbers
+uint64_t OSMGenerator::Next(void)
+{
+	this->state ^= this->state >> 12;
+	this->state ^= this->state << 25;
+	this->state ^= this->state >> 27;
+	return this->state * 2685821657736338717ULL;
+}
+
+// Random number in [0, 1)
+double OSMGenerator::NextDouble(void)
+{
+	return (Next() >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,61 @@
+/*
+ * Synthetic OpenStreetMap XML generator declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCH_OSMGENERATOR_H_
+#define BENCH_OSMGENERATOR_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Shape of the generated map
+struct osmgen_params
+{
+	unsigned long nodes;        // Number of nodes
+	unsigned int way_length;    // Nodes per way
+	double highways;            // Fraction of the ways tagged as highways
+	double names;               // Fraction of the highways with a name
+	double oneways;             // Fraction of the highways with oneway=yes
+	double maxspeeds;           // Fraction of the highways with a maxspeed
+	double outside;             // Fraction of the nodes outside the bounds
+	uint64_t seed;
+};
+
+// This class writes a synthetic OpenStreetMap XML map. The nodes lie on a
+// jittered grid and the ways are random walks over it, so neighbouring
+// ways share nodes like real streets do. The output only depends on the
+// parameters (the random numbers don't come from the C++ library).
+class OSMGenerator
+{
+public:
+	OSMGenerator(const osmgen_params &params);
+
+	static osmgen_params GetDefaults(void);
+
+	bool Write(FILE *fp);
+	unsigned long GetWays(void);
+
+private:
+	uint64_t Next(void);
+	double NextDouble(void);
+
+	osmgen_params params;
+	uint64_t state;
+	unsigned long ways;
+};
+
+#endif /* BENCH_OSMGENERATOR_H_ */
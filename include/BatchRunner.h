@@ -0,0 +1,95 @@
+/*
+ * Batch conversion declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_BATCHRUNNER_H_
+#define INCLUDE_BATCHRUNNER_H_
+
+#include <wx/wx.h>
+#include <NetworkBuilder.h>
+#include <TagRules.h>
+#include <ThreadPool.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A conversion of a batch
+struct batch_job
+{
+	wxString input;
+	wxString output;
+	long int width, height, speedlimit;     // 0 for the defaults
+	bool ok;
+	double seconds;
+	stats_counters counters;
+};
+
+// An input of a batch, read once for all its jobs
+class BatchInput: public OSMHandler
+{
+public:
+	virtual void OnBounds(const osm_bounds &bounds);
+	virtual void OnNode(const osm_node &node);
+	virtual void OnWay(const osm_way &way);
+
+	wxString name;
+	const TagRules *rules = NULL;
+	std::vector<size_t> jobs;               // Jobs using this input
+	bool has_bounds = false;
+	osm_bounds bounds;
+	NodeIndex nodes;
+	std::vector<highway> highways;
+	std::unique_ptr<Simplifier> simplifier;
+	unsigned long long size = 0;            // Size of the file
+};
+
+// This class runs the jobs listed in a manifest file, one per line:
+//
+//   input output [width [height [speed]]]
+//
+// The fields are separated by tabs (or by spaces, if there are no tabs),
+// empty lines and lines starting with '#' are skipped, and 0 or a missing
+// number keeps the value of the command line. Each distinct input is read
+// once, and its jobs share what was read. Reading and converting are all
+// tasks of the same thread pool, so the jobs of an input start as soon as
+// it is read.
+class BatchRunner
+{
+public:
+	BatchRunner(const network_options &options, const TagRules &rules, double tolerance, unsigned int threads);
+
+	bool Run(wxString manifest);
+
+private:
+	bool Load(wxString manifest);
+	void ReadInput(std::shared_ptr<BatchInput> input);
+	void RunJob(std::shared_ptr<BatchInput> input, batch_job &job);
+
+	network_options options;
+	const TagRules &rules;
+	double tolerance;
+	unsigned int threads;
+	unsigned int reader_threads;
+	std::vector<batch_job> jobs;
+	std::vector<std::shared_ptr<BatchInput> > inputs;
+	std::unique_ptr<ThreadPool> pool;
+	std::mutex lock;                        // Guards the status lines and the totals
+	size_t finished = 0;
+	unsigned long long bytes_read = 0;
+};
+
+#endif /* INCLUDE_BATCHRUNNER_H_ */
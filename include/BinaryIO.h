@@ -0,0 +1,66 @@
+/*
+ * Plain binary file helpers.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_BINARYIO_H_
+#define INCLUDE_BINARYIO_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// Files written with these functions use the byte order of the machine.
+// They are meant for data kept between runs, not for exchange.
+
+// Saved in the files to tell machines with another byte order apart
+#define BINARYIO_BYTE_ORDER 0x01020304
+
+// Largest array accepted when reading (guards against corrupt files)
+#define BINARYIO_MAX_ARRAY (1ULL << 40)
+
+// Write and read plain values
+template <typename T>
+inline bool BinaryPut(FILE *fp, const T &value)
+{
+	return fwrite(&value, sizeof(T), 1, fp) == 1;
+}
+
+template <typename T>
+inline bool BinaryGet(FILE *fp, T &value)
+{
+	return fread(&value, sizeof(T), 1, fp) == 1;
+}
+
+// Write and read arrays, with their size first
+template <typename T>
+inline bool BinaryPutArray(FILE *fp, const T *data, uint64_t size)
+{
+	return BinaryPut(fp, size) && ((size == 0) || (fwrite(data, sizeof(T), size, fp) == size));
+}
+
+template <typename T>
+inline bool BinaryGetArray(FILE *fp, std::vector<T> &data)
+{
+	uint64_t size;
+	if (!BinaryGet(fp, size) || (size > BINARYIO_MAX_ARRAY / sizeof(T)))
+		return false;
+
+	data.resize(size);
+	return (size == 0) || (fread(&data[0], sizeof(T), size, fp) == size);
+}
+
+#endif /* INCLUDE_BINARYIO_H_ */
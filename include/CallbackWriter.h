@@ -0,0 +1,62 @@
+/*
+ * MobSink network callback writer declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_CALLBACKWRITER_H_
+#define INCLUDE_CALLBACKWRITER_H_
+
+#include <NetworkWriter.h>
+#include <Path.h>
+#include <functional>
+#include <vector>
+
+// This class gives the paths of a network to functions of the caller as
+// soon as they are written, so that a program converting a map in memory
+// can use the paths while the conversion goes on. The begin function is
+// optional and gets the size and speed limit of the network before the
+// first path.
+class CallbackWriter: public NetworkWriter
+{
+public:
+	typedef std::function<void(long width, long height, long speedlimit)> begin_function;
+	typedef std::function<void(Path &path)> path_function;
+
+	CallbackWriter(path_function on_path, begin_function on_begin = begin_function());
+
+	virtual void Begin(long width, long height, long speedlimit);
+	virtual void Write(Path &path);
+	virtual bool End(void);
+	virtual bool IsStarted(void);
+	virtual unsigned long long GetBytesWritten(void);
+
+private:
+	path_function on_path;
+	begin_function on_begin;
+	bool started;
+};
+
+// This class adds the paths of a network to a vector of the caller and
+// keeps the network size and speed limit
+class PathListWriter: public CallbackWriter
+{
+public:
+	PathListWriter(std::vector<Path> &paths);
+
+	long width, height, speedlimit;
+};
+
+#endif /* INCLUDE_CALLBACKWRITER_H_ */
@@ -0,0 +1,65 @@
+/*
+ * Conversion state declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_CONVERSIONSTATE_H_
+#define INCLUDE_CONVERSIONSTATE_H_
+
+#include <NodeIndex.h>
+#include <Point.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define CONVERSIONSTATE_MAGIC "O2MSTATE"
+#define CONVERSIONSTATE_VERSION 4
+
+// A highway of the converted network and the points of its paths
+struct state_way
+{
+	std::vector<int64_t> refs;
+	std::string name;               // UTF-8
+	int flow;                       // pathflow
+	float speedlimit;
+	std::vector<Point> points;      // Projected (and simplified) nodes
+};
+
+// This class keeps what a later run needs to apply an OSM change file
+// without reading the whole map again: the conversion settings, the
+// location of every node inside the boundaries and the highways with
+// their paths, by way id. It is saved in the byte order of the machine.
+class ConversionState
+{
+public:
+	ConversionState();
+
+	bool Save(FILE *fp, NodeIndex &nodes);
+	bool Load(FILE *fp, NodeIndex &nodes);
+
+	// Settings of the conversion
+	double minlat, maxlat, minlon, maxlon;
+	long int width, height, speedlimit;
+	double tolerance;
+	int projection;                 // projectiontype
+	uint64_t rules;                 // Key of the tag rules (TagRules::key)
+
+	std::map<int64_t, state_way> ways;
+};
+
+#endif /* INCLUDE_CONVERSIONSTATE_H_ */
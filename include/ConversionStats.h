@@ -0,0 +1,110 @@
+/*
+ * Conversion statistics declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_CONVERSIONSTATS_H_
+#define INCLUDE_CONVERSIONSTATS_H_
+
+#include <atomic>
+#include <stdio.h>
+#include <string>
+#include <time.h>
+
+// Version of the JSON written by ConversionStats::Write(). Only bump it
+// when a member changes its meaning or is removed.
+#define CONVERSIONSTATS_VERSION 1
+
+// Phases of a conversion
+enum stats_phase
+{
+	STATS_REFERENCES,   // First pass of the two pass mode
+	STATS_READ,         // Reading the input (the paths are created and written as the ways arrive)
+	STATS_SIMPLIFY,     // Simplifying the ways kept until the junctions were known
+	STATS_GRAPH,        // Building, pruning and contracting the road graph
+	STATS_JOIN,         // Slim mode: finding the nodes of the highways on disk
+	STATS_FINISH,       // Closing the network or writing the tiles
+	STATS_PHASES,
+};
+
+// Event counters
+struct stats_counters
+{
+	unsigned long long nodes_read;      // Nodes reported by the reader
+	unsigned long long nodes_outside;   // Nodes discarded by the bounds check
+	unsigned long long ways_read;       // Ways reported by the reader
+	unsigned long long highways;        // Ways kept as highways
+	unsigned long long refs_missing;    // Highway node references not found in the node index
+	unsigned long long paths;           // Paths written
+	unsigned long long crossings;       // Crossings of paths without a shared node (with --crossings)
+	unsigned long long bytes_written;   // Bytes of network written
+};
+
+// Allocation counters. They are kept by the global operator new and delete
+// in AllocationCount.cpp, which only the command line and the benchmark
+// build: the library leaves the allocator of the program that links it
+// alone, so there nothing is counted. The aligned forms (the ones taking a
+// std::align_val_t) are not replaced, so they are never counted.
+struct stats_allocations
+{
+	std::atomic<bool> counting;
+	std::atomic<unsigned long long> allocations;
+	std::atomic<unsigned long long> deallocations;
+};
+
+// This class times the phases of a conversion and counts what happened in
+// them. Counting is just incrementing integers and each phase reads the
+// clocks twice, so it is always on. Allocations are only counted after
+// EnableAllocationCount() (it costs a relaxed atomic add per allocation),
+// and only if the counting operators are linked in; it returns false if
+// they aren't.
+class ConversionStats
+{
+public:
+	ConversionStats();
+
+	void Start(stats_phase phase);
+	void Stop(stats_phase phase);
+	bool Write(FILE *fp, const char *input, const char *output, bool ok);
+	bool IsRun(stats_phase phase);
+	double GetWallSeconds(stats_phase phase);
+	double GetCPUSeconds(stats_phase phase);
+
+	static std::string Escape(const char *text);
+	static const char *GetPhaseName(stats_phase phase);
+	static void SetAllocationCounter(stats_allocations *counter);
+	static bool EnableAllocationCount(void);
+	static unsigned long long GetPeakMemory(void);
+	static double GetWallTime(void);
+
+	stats_counters counters;
+
+private:
+	struct phase_time
+	{
+		bool run;
+		double wall;
+		double cpu;
+		double wall_start;
+		clock_t cpu_start;
+	};
+
+	phase_time phases[STATS_PHASES];
+
+	static stats_allocations *allocation_counter;
+};
+
+#endif /* INCLUDE_CONVERSIONSTATS_H_ */
@@ -0,0 +1,133 @@
+/*
+ * OpenStreetMap to MobSink conversion declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_CONVERTER_H_
+#define INCLUDE_CONVERTER_H_
+
+// Input reading passes
+enum readpass
+{
+	READPASS_SINGLE,        // Read everything at once
+	READPASS_REFERENCES,    // Two passes: find the nodes used by highways
+	READPASS_NODES,         // Two passes: read only the nodes found before
+	READPASS_CHANGES,       // Read an OSM change file
+};
+
+#include <OSMReader.h>
+#include <InputStream.h>
+#include <NodeIndex.h>
+#include <NodeSet.h>
+#include <NetworkBuilder.h>
+#include <Simplifier.h>
+#include <ConversionStats.h>
+#include <ConversionState.h>
+#include <ParseCache.h>
+#include <RoadGraph.h>
+#include <SlimStore.h>
+#include <TagRules.h>
+#include <Path.h>
+#include <Point.h>
+#include <istream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// The changes read from an OSM change file. The last action on an
+// element is the one that counts.
+struct mapchanges
+{
+	osm_action action;                      // Action of the elements being read
+	std::map<int64_t, osm_node> nodes;      // Created or modified nodes
+	std::map<int64_t, highway> ways;        // Created or modified highways
+	std::set<int64_t> deleted_nodes;
+	std::set<int64_t> deleted_ways;         // Deleted ways (or no longer highways)
+};
+
+// This class converts an OpenStreetMap file (or a MobSink network) to a
+// MobSink network, or applies an OSM change file to a saved state. It
+// only needs its settings to be filled in: it doesn't depend on the
+// command line or on wxWidgets (other than the wxString names of MobSink's
+// paths), so other programs can run conversions with it.
+// Programs can also convert an OpenStreetMap XML or PBF document that is
+// in memory (or in a C++ stream), getting the paths from a writer of their
+// own, like a CallbackWriter, as soon as they are created. The input and
+// output files, the cache, the tiles and the changes are not used then.
+class Converter: private OSMHandler
+{
+public:
+	bool Run(void);
+	bool Run(const char *data, size_t size, NetworkWriter &writer);
+	bool Run(std::istream &input, NetworkWriter &writer);
+
+	// Settings (the file names are given to fopen() as they are)
+	std::string inputfile;
+	std::string outputfile;
+	std::string statsfile;                  // Optional
+	std::string statefile;                  // Optional
+	std::string changesfile;                // Applied to statefile, instead of reading inputfile
+	std::string cachedir;                   // Optional
+	long int threads = 0;
+	bool twopass = false;
+	double tolerance = 0;
+	bool network_input = false;
+	long int min_component = 0;
+	bool contract = false;
+	long int memory_limit = 0;              // Slim mode: MB of memory for what is read (0 is off)
+	FILE *messages = stdout;                // Summaries and errors of the conversion
+	network_options options;
+	TagRules rules;
+
+	ConversionStats stats;
+
+private:
+	bool Run(InputStream &input, bool pbf, NetworkWriter &writer);
+	bool Convert(const std::string &input, const std::string &output);
+	bool Convert(InputStream *file, FILE *statefp);
+	bool ConvertNetwork(const std::string &input, const std::string &output);
+	void WriteNetworkPath(NetworkWriter &writer, PathStore &paths, Path &path);
+	bool ReadInput(InputStream &stream);
+	bool ReadCache(const std::string &cachefile, ParseCache &cache);
+	bool SaveCache(const std::string &cachefile);
+	bool ApplyChanges(FILE *fp);
+	bool SaveState(void);
+	void AddHighway(highway &road);
+	void InsertHighway(highway &road);
+	void WriteStats(bool ok);
+
+	// OSM reader events
+	virtual void OnBounds(const osm_bounds &bounds);
+	virtual void OnNode(const osm_node &node);
+	virtual void OnWay(const osm_way &way);
+	virtual void OnAction(osm_action action);
+
+	// Conversion data
+	readpass pass = READPASS_SINGLE;
+	bool pbf = false;                       // The input is PBF instead of XML
+	NodeSet referenced;
+	NodeIndex nodes;
+	NetworkBuilder builder;
+	ConversionState *state = NULL;
+	ParseCache *cache = NULL;
+	RoadGraph *graph = NULL;
+	SlimStore *slim = NULL;
+	mapchanges changes;
+	std::vector<highway> highways;
+};
+
+#endif /* INCLUDE_CONVERTER_H_ */
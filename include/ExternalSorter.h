@@ -0,0 +1,200 @@
+/*
+ * External sort declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_EXTERNALSORTER_H_
+#define INCLUDE_EXTERNALSORTER_H_
+
+#include <stdio.h>
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Smallest number of records read at a time from a run
+#define EXTERNALSORTER_MIN_BLOCK 4096
+
+// This class sorts more records than fit in memory. The records are kept
+// in a buffer of a fixed size; when it is full, it is sorted and written
+// to a file (a run). ForEach() then merges the runs, reading each one a
+// block at a time, so both the runs and the merge use sequential I/O.
+// The records must be plain data, and Less compares them.
+template <typename T, typename Less>
+class ExternalSorter
+{
+public:
+	// The files are named prefix.0, prefix.1, ... and the buffers use
+	// about this many bytes
+	ExternalSorter(const std::string &prefix, size_t memory)
+	{
+		this->prefix = prefix;
+		this->capacity = std::max(memory / sizeof(T), (size_t)EXTERNALSORTER_MIN_BLOCK);
+		this->ok = true;
+	}
+
+	~ExternalSorter()
+	{
+		Clear();
+	}
+
+	// Add a record
+	void Add(const T &record)
+	{
+		if (this->buffer.empty())
+			this->buffer.reserve(this->capacity);
+
+		this->buffer.push_back(record);
+		if (this->buffer.size() == this->capacity)
+			WriteRun();
+	}
+
+	// Call visit(record) for all the records, in order, and remove them.
+	// Returns false if the runs could not be written or read.
+	template <typename F>
+	bool ForEach(F visit)
+	{
+		// Everything fits in memory
+		if (this->runs.empty())
+		{
+			std::sort(this->buffer.begin(), this->buffer.end(), Less());
+			for (size_t i = 0; i < this->buffer.size(); i++)
+				visit(this->buffer[i]);
+
+			Clear();
+			return this->ok;
+		}
+
+		if (!this->buffer.empty())
+			WriteRun();
+
+		std::vector<T>().swap(this->buffer);
+		bool ok = this->ok && Merge(visit);
+		Clear();
+		return ok;
+	}
+
+	// Remove all the records and their files
+	void Clear(void)
+	{
+		std::vector<T>().swap(this->buffer);
+		for (size_t i = 0; i < this->runs.size(); i++)
+			remove(this->runs[i].c_str());
+
+		this->runs.clear();
+		this->ok = true;
+	}
+
+	size_t GetRuns(void)
+	{
+		return this->runs.size();
+	}
+
+private:
+	// A run being merged
+	struct run_reader
+	{
+		run_reader() {}
+		run_reader(const run_reader &) = delete;
+		~run_reader() { if (this->fp) fclose(this->fp); }
+
+		FILE *fp = NULL;
+		std::vector<T> block;
+		size_t position;
+	};
+
+	// Sort the buffer and write it to a new run
+	void WriteRun(void)
+	{
+		std::sort(this->buffer.begin(), this->buffer.end(), Less());
+
+		std::string name = this->prefix + "." + std::to_string(this->runs.size());
+		FILE *fp = fopen(name.c_str(), "wb");
+		this->runs.push_back(name);
+
+		if (!fp)
+			this->ok = false;
+		else if ((fwrite(this->buffer.data(), sizeof(T), this->buffer.size(), fp) != this->buffer.size()) | (fclose(fp) != 0))
+			this->ok = false;
+
+		this->buffer.clear();
+	}
+
+	// Read the next block of a run. Returns false at its end.
+	bool ReadBlock(run_reader &run, size_t size)
+	{
+		run.block.resize(size);
+		size_t n = fread(run.block.data(), sizeof(T), size, run.fp);
+		run.block.resize(n);
+		run.position = 0;
+		return n > 0;
+	}
+
+	// Merge the runs, always taking the smallest of their first records
+	template <typename F>
+	bool Merge(F visit)
+	{
+		size_t count = this->runs.size();
+		size_t block = std::max(this->capacity / count, (size_t)EXTERNALSORTER_MIN_BLOCK);
+		std::vector<run_reader> readers(count);
+
+		// The queue has the index of each run that still has records
+		Less less;
+		auto greater = [&readers, &less](size_t a, size_t b)
+		{
+			return less(readers[b].block[readers[b].position], readers[a].block[readers[a].position]);
+		};
+		std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			readers[i].fp = fopen(this->runs[i].c_str(), "rb");
+			if (!readers[i].fp)
+				return false;
+
+			if (ReadBlock(readers[i], block))
+				queue.push(i);
+		}
+
+		while (!queue.empty())
+		{
+			size_t i = queue.top();
+			queue.pop();
+
+			run_reader &run = readers[i];
+			visit(run.block[run.position]);
+
+			if ((++run.position < run.block.size()) || ReadBlock(run, block))
+				queue.push(i);
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (ferror(readers[i].fp))
+				return false;
+		}
+
+		return true;
+	}
+
+	std::string prefix;
+	std::vector<T> buffer;
+	std::vector<std::string> runs;          // Names of the run files
+	size_t capacity;                        // Records in the buffer
+	bool ok;
+};
+
+#endif /* INCLUDE_EXTERNALSORTER_H_ */
@@ -0,0 +1,173 @@
+/*
+ * Input stream declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_INPUTSTREAM_H_
+#define INCLUDE_INPUTSTREAM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Size of the blocks read from compressed files
+#define INPUTSTREAM_BLOCK_SIZE (1 << 20)
+
+// Number of decompressed blocks waiting to be read
+#define INPUTSTREAM_QUEUE_SIZE 8
+
+// A sequence of bytes read from start to end. Read() only returns less
+// than was asked for at the end of the data or on errors.
+class InputStream
+{
+public:
+	virtual ~InputStream() {}
+
+	virtual size_t Read(void *data, size_t size) = 0;
+	virtual bool IsEnd(void) = 0;
+	virtual bool IsError(void) = 0;
+	virtual bool Rewind(void) = 0;
+
+	static InputStream *Open(const std::string &name, unsigned int threads = 0);
+	static std::string GetPlainName(const std::string &name);
+	static bool HasExtension(const std::string &name, const char *extension);
+};
+
+// An uncompressed file
+class FileStream: public InputStream
+{
+public:
+	FileStream(FILE *fp, bool owner = false);
+	virtual ~FileStream();
+
+	virtual size_t Read(void *data, size_t size);
+	virtual bool IsEnd(void);
+	virtual bool IsError(void);
+	virtual bool Rewind(void);
+
+private:
+	FILE *fp;
+	bool owner;                             // Close the file when done
+};
+
+// Data already in memory (owned by the caller)
+class MemoryStream: public InputStream
+{
+public:
+	MemoryStream(const void *data, size_t size);
+
+	virtual size_t Read(void *data, size_t size);
+	virtual bool IsEnd(void);
+	virtual bool IsError(void);
+	virtual bool Rewind(void);
+
+private:
+	const char *data;
+	size_t size;
+	size_t offset;
+};
+
+// A standard C++ input stream (owned by the caller). It can only be
+// rewound if the stream can seek.
+class StdStream: public InputStream
+{
+public:
+	StdStream(std::istream &stream);
+
+	virtual size_t Read(void *data, size_t size);
+	virtual bool IsEnd(void);
+	virtual bool IsError(void);
+	virtual bool Rewind(void);
+
+private:
+	std::istream &stream;
+	std::streampos start;                   // Where the data starts (-1 if it can't seek)
+};
+
+// A compressed file, decompressed by a background thread while the data
+// already decompressed is read, so reading and parsing overlap
+class DecompressStream: public InputStream
+{
+public:
+	DecompressStream(FILE *fp);
+	virtual ~DecompressStream();
+
+	virtual size_t Read(void *data, size_t size);
+	virtual bool IsEnd(void);
+	virtual bool IsError(void);
+	virtual bool Rewind(void);
+
+protected:
+	void Start(void);
+	void Stop(void);
+	bool Put(const char *data, size_t size);
+	bool IsStopping(void);
+
+	// Decompress the whole file, giving the data to Put(). Runs in the
+	// background thread and returns false on errors.
+	virtual bool Decompress(void) = 0;
+
+	FILE *fp;
+
+private:
+	void Run(void);
+
+	std::thread worker;
+	std::mutex lock;
+	std::condition_variable changed;
+	std::deque<std::string> blocks;         // Decompressed, waiting to be read
+	size_t offset;                          // Bytes of the first block already read
+	bool finished;
+	bool error;
+	std::atomic<bool> stop;
+};
+
+// A gzip file (one or more members)
+class GzipStream: public DecompressStream
+{
+public:
+	GzipStream(FILE *fp);
+	virtual ~GzipStream();
+
+protected:
+	virtual bool Decompress(void);
+};
+
+// A bzip2 file (one or more streams). With more than one thread, the
+// compressed blocks are found in the file and decompressed in parallel.
+class Bzip2Stream: public DecompressStream
+{
+public:
+	Bzip2Stream(FILE *fp, unsigned int threads);
+	virtual ~Bzip2Stream();
+
+protected:
+	virtual bool Decompress(void);
+
+private:
+	bool DecompressSerial(void);
+	bool DecompressParallel(void);
+
+	unsigned int threads;
+};
+
+#endif /* INCLUDE_INPUTSTREAM_H_ */
@@ -0,0 +1,302 @@
+/*
+ * MobSink binary network format and reader.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_MOBSINKBINARY_H_
+#define INCLUDE_MOBSINKBINARY_H_
+
+/* The binary network is a little-endian file laid out so that it can be
+ * memory mapped and used in place:
+ *
+ *   mobsinkbin_header
+ *   mobsinkbin_path[path_count]          path table
+ *   mobsinkbin_control[control_count]    control table (path_control_params)
+ *   uint64_t[name_count + 1]             offsets of the names in the strings
+ *   char[string_size]                    UTF-8 names, each ending with a NUL
+ *
+ * Every section starts at a multiple of 8 bytes. Name 0 is the empty name.
+ * The controls of a path are contiguous and sorted by time, and every path
+ * has at least one (time 0, like a new Path). This header only depends on
+ * the C++ standard library, so a simulator can include it on its own.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+// Keep windows.h from defining min() and max() (and most of the API) in
+// the files that include this header
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define MOBSINKBIN_MAGIC "MOBSINKB"
+#define MOBSINKBIN_VERSION 1
+
+// File header
+struct mobsinkbin_header
+{
+	char magic[8];              // MOBSINKBIN_MAGIC (no NUL)
+	uint32_t version;           // MOBSINKBIN_VERSION
+	uint32_t header_size;       // sizeof(mobsinkbin_header)
+	int64_t width;
+	int64_t height;
+	int64_t speedlimit;
+	uint64_t path_count;
+	uint64_t path_offset;
+	uint64_t control_count;
+	uint64_t control_offset;
+	uint64_t name_count;
+	uint64_t name_offset;
+	uint64_t string_size;
+	uint64_t string_offset;
+	uint64_t reserved[3];
+};
+
+// A path
+struct mobsinkbin_path
+{
+	float xa, ya, xb, yb;
+	uint32_t name;              // Index in the name table
+	uint32_t flow;              // pathflow
+	uint32_t control_first;     // Index of the first control of this path
+	uint32_t control_count;
+};
+
+// A control point (path_control_params at a time)
+struct mobsinkbin_control
+{
+	int32_t time;
+	float speedlimit;
+	float traffic;
+	uint32_t blocked;
+};
+
+// Gives access to a binary network in memory without copying it. The data
+// must stay valid (and mapped) while the reader is used.
+class MobSinkBinaryReader
+{
+public:
+	MobSinkBinaryReader()
+	{
+		this->data = NULL;
+		this->size = 0;
+	}
+
+	// Check the data and start using it. Only little-endian hosts can read
+	// the tables in place.
+	bool Open(const void *data, size_t size)
+	{
+		const uint16_t endian = 1;
+		const mobsinkbin_header *h = (const mobsinkbin_header *)data;
+
+		this->data = NULL;
+		this->size = 0;
+
+		if ((*(const uint8_t *)&endian != 1) || !data || (size < sizeof(mobsinkbin_header)) || ((uintptr_t)data % 8 != 0))
+			return false;
+
+		if ((memcmp(h->magic, MOBSINKBIN_MAGIC, 8) != 0) || (h->version != MOBSINKBIN_VERSION) || (h->header_size != sizeof(mobsinkbin_header)))
+			return false;
+
+		if (!CheckSection(h->path_offset, h->path_count, sizeof(mobsinkbin_path), size) ||
+			!CheckSection(h->control_offset, h->control_count, sizeof(mobsinkbin_control), size) ||
+			(h->name_count == 0) || (h->name_count > UINT32_MAX) ||
+			!CheckSection(h->name_offset, h->name_count + 1, sizeof(uint64_t), size) ||
+			!CheckSection(h->string_offset, h->string_size, 1, size))
+			return false;
+
+		// The names must lie in the strings and end with a NUL
+		const uint64_t *names = (const uint64_t *)((const char *)data + h->name_offset);
+		const char *strings = (const char *)data + h->string_offset;
+		if ((names[0] != 0) || (names[h->name_count] != h->string_size))
+			return false;
+
+		for (uint64_t i = 0; i < h->name_count; i++)
+		{
+			if ((names[i] >= names[i + 1]) || (strings[names[i + 1] - 1] != 0))
+				return false;
+		}
+
+		// The paths must point inside the other tables
+		const mobsinkbin_path *paths = (const mobsinkbin_path *)((const char *)data + h->path_offset);
+		for (uint64_t i = 0; i < h->path_count; i++)
+		{
+			if ((paths[i].name >= h->name_count) || (paths[i].control_count == 0) ||
+				((uint64_t)paths[i].control_first + paths[i].control_count > h->control_count))
+				return false;
+		}
+
+		this->data = (const char *)data;
+		this->size = size;
+		return true;
+	}
+
+	bool IsOk(void) const
+	{
+		return this->data != NULL;
+	}
+
+	const mobsinkbin_header *GetHeader(void) const
+	{
+		return (const mobsinkbin_header *)this->data;
+	}
+
+	uint64_t GetPathCount(void) const
+	{
+		return GetHeader()->path_count;
+	}
+
+	const mobsinkbin_path *GetPaths(void) const
+	{
+		return (const mobsinkbin_path *)(this->data + GetHeader()->path_offset);
+	}
+
+	// Controls of a path (path.control_count of them)
+	const mobsinkbin_control *GetControls(const mobsinkbin_path &path) const
+	{
+		return (const mobsinkbin_control *)(this->data + GetHeader()->control_offset) + path.control_first;
+	}
+
+	uint64_t GetNameCount(void) const
+	{
+		return GetHeader()->name_count;
+	}
+
+	// NUL terminated UTF-8 name. length (if given) gets its size without the NUL.
+	const char *GetName(uint32_t id, size_t *length = NULL) const
+	{
+		const uint64_t *names = (const uint64_t *)(this->data + GetHeader()->name_offset);
+		if (length)
+			*length = names[id + 1] - names[id] - 1;
+
+		return this->data + GetHeader()->string_offset + names[id];
+	}
+
+private:
+	static bool CheckSection(uint64_t offset, uint64_t count, uint64_t item, size_t size)
+	{
+		return (offset % 8 == 0) && (offset >= sizeof(mobsinkbin_header)) && (offset <= size) && (count <= (size - offset) / item);
+	}
+
+	const char *data;
+	size_t size;
+};
+
+// Maps a binary network file to memory, read only
+class MobSinkBinaryFile
+{
+public:
+	MobSinkBinaryFile()
+	{
+		this->data = NULL;
+		this->size = 0;
+	}
+
+	~MobSinkBinaryFile()
+	{
+		Close();
+	}
+
+	bool Open(const char *filename)
+	{
+		Close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER length;
+		HANDLE mapping = NULL;
+		if (GetFileSizeEx(file, &length) && (length.QuadPart > 0))
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping)
+		{
+			this->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			this->size = length.QuadPart;
+			CloseHandle(mapping);
+		}
+
+		CloseHandle(file);
+#else
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if ((fstat(fd, &info) == 0) && (info.st_size > 0))
+		{
+			void *p = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (p != MAP_FAILED)
+			{
+				this->data = p;
+				this->size = info.st_size;
+			}
+		}
+
+		close(fd);
+#endif
+
+		if (!this->data)
+			this->size = 0;
+
+		return this->data != NULL;
+	}
+
+	void Close(void)
+	{
+		if (!this->data)
+			return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(this->data);
+#else
+		munmap(this->data, this->size);
+#endif
+		this->data = NULL;
+		this->size = 0;
+	}
+
+	const void *GetData(void) const
+	{
+		return this->data;
+	}
+
+	size_t GetSize(void) const
+	{
+		return this->size;
+	}
+
+private:
+	void *data;
+	size_t size;
+};
+
+#endif /* INCLUDE_MOBSINKBINARY_H_ */
@@ -0,0 +1,67 @@
+/*
+ * MobSink binary network writer declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_MOBSINKBINARYWRITER_H_
+#define INCLUDE_MOBSINKBINARYWRITER_H_
+
+#include <NetworkWriter.h>
+#include <MobSinkBinary.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Size of the output buffer
+#define MOBSINKBINARYWRITER_BUFFER_SIZE (1 << 20)
+
+// This class writes a network in the binary format of MobSinkBinary.h.
+// The path table is streamed to the file; the controls and names are
+// kept until End(), which appends them and fills in the header, so the
+// output file must be seekable.
+class MobSinkBinaryWriter: public NetworkWriter
+{
+public:
+	MobSinkBinaryWriter(FILE *fp);
+
+	virtual void Begin(long width, long height, long speedlimit);
+	virtual void Write(Path &path);
+	virtual bool End(void);
+	virtual bool IsStarted(void);
+	virtual unsigned long long GetBytesWritten(void);
+
+private:
+	void Put32(uint32_t value);
+	void Put64(uint64_t value);
+	void PutFloat(float value);
+	void Pad(void);
+	void Flush(void);
+
+	FILE *fp;
+	std::vector<unsigned char> buffer;
+	unsigned long long written;
+	bool started;
+	bool ok;
+
+	mobsinkbin_header header;
+	std::vector<mobsinkbin_control> controls;
+	std::unordered_map<std::string, uint32_t> name_ids;
+	std::vector<uint64_t> names;            // Offsets in strings
+	std::string strings;
+};
+
+#endif /* INCLUDE_MOBSINKBINARYWRITER_H_ */
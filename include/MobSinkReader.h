@@ -0,0 +1,71 @@
+/*
+ * MobSink XML network reader declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_MOBSINKREADER_H_
+#define INCLUDE_MOBSINKREADER_H_
+
+#include <Path.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// This class reads the paths of a MobSink XML network that is in memory,
+// one at a time, without building a document. The network is a <network>
+// root with <path> elements, each with its <traffic> controls, as written
+// by MobSinkWriter; other elements are skipped. The text must be UTF-8.
+// The data must stay valid while the reader is used.
+class MobSinkReader
+{
+public:
+	MobSinkReader();
+
+	bool Open(const char *data, size_t size);
+	bool Next(Path &path);
+	bool IsOk(void);
+
+	// Attributes of the network
+	long width, height, speedlimit;
+
+private:
+	// An attribute of the current element
+	struct xml_attribute
+	{
+		std::string_view name;
+		std::string value;
+	};
+
+	bool NextElement(void);
+	size_t FindTagEnd(size_t from);
+	bool ParseElement(size_t end);
+	std::string GetAttribute(const char *name, const char *value = "");
+
+	const char *data;
+	size_t size;
+	size_t position;
+	bool ok;
+	bool done;                              // The root was closed
+	std::string element;                    // Name of the current element
+	bool closing;                           // It is an end tag
+	bool empty;                             // It has no content
+	std::vector<xml_attribute> attrs;       // Its attributes (reused)
+	size_t nattrs;
+	std::vector<std::string> stack;         // Names of the open elements
+};
+
+#endif /* INCLUDE_MOBSINKREADER_H_ */
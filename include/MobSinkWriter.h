@@ -0,0 +1,98 @@
+/*
+ * MobSink XML network writer declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_MOBSINKWRITER_H_
+#define INCLUDE_MOBSINKWRITER_H_
+
+#include <NetworkWriter.h>
+#include <ThreadPool.h>
+#include <Path.h>
+#include <stdio.h>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Size of the output buffer
+#define MOBSINKWRITER_BUFFER_SIZE (1 << 20)
+
+// Number of paths formatted together by a thread
+#define MOBSINKWRITER_CHUNK_SIZE 8192
+
+// Default and maximum number of decimal digits of the coordinates
+#define MOBSINKWRITER_PRECISION 6
+#define MOBSINKWRITER_MAX_PRECISION 12
+
+// What is written of a path
+struct mobsink_path
+{
+	std::string name;                       // UTF-8
+	float xa, ya, xb, yb;
+	bool oneway;
+	bool has_speedlimit;
+	float speedlimit;
+};
+
+// This class writes a MobSink network straight into a buffered file, one
+// path at a time. The output is laid out exactly as wxXmlDocument::Save()
+// does it, and the numbers are printed as "%f" with the chosen precision.
+// With more than one thread, the paths are gathered in chunks that are
+// formatted in parallel, each into its own text, and the texts are
+// written in the order of the chunks, so the file is the same.
+class MobSinkWriter: public NetworkWriter
+{
+public:
+	MobSinkWriter(FILE *fp, int precision = MOBSINKWRITER_PRECISION, unsigned int threads = 1);
+
+	virtual void Begin(long width, long height, long speedlimit);
+	virtual void Write(Path &path);
+	virtual bool End(void);
+	virtual bool IsStarted(void);
+	virtual unsigned long long GetBytesWritten(void);
+
+	static size_t FormatFloat(char *out, float value, int precision);
+
+private:
+	static void GetPath(Path &path, mobsink_path &out);
+	static void FormatPath(std::string &out, const mobsink_path &path, int precision);
+	static std::string FormatChunk(const std::vector<mobsink_path> &paths, int precision);
+	static void AppendEscaped(std::string &out, const char *data);
+	static void AppendFloat(std::string &out, float value, int precision);
+
+	void SubmitChunk(void);
+	void WriteChunk(void);
+	void WriteData(const std::string &data);
+	void Flush(void);
+
+	FILE *fp;
+	int precision;
+	std::string buffer;
+	mobsink_path current;                   // Path being written (to reuse its memory)
+	unsigned long long written;
+	bool started;
+	bool has_paths;
+	bool ok;
+
+	// Parallel formatting
+	std::unique_ptr<ThreadPool> pool;
+	std::shared_ptr<std::vector<mobsink_path> > chunk;
+	std::deque<std::future<std::string> > pending;      // Chunks being formatted, in order
+};
+
+#endif /* INCLUDE_MOBSINKWRITER_H_ */
@@ -0,0 +1,147 @@
+/*
+ * MobSink network builder declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_NETWORKBUILDER_H_
+#define INCLUDE_NETWORKBUILDER_H_
+
+#define DEFAULT_SPEED 50
+
+// Network output formats
+enum outputformat
+{
+	OUTPUT_XML,             // MobSink XML
+	OUTPUT_BIN,             // Binary (see MobSinkBinary.h)
+};
+
+// What is done with paths that cross without a shared node
+enum crossingmode
+{
+	CROSSINGS_IGNORE,       // Nothing (default)
+	CROSSINGS_REPORT,       // List them
+	CROSSINGS_SPLIT,        // Split the paths at the crossings
+};
+
+#include <OSMReader.h>
+#include <NodeIndex.h>
+#include <NetworkWriter.h>
+#include <MobSinkWriter.h>
+#include <Simplifier.h>
+#include <Projection.h>
+#include <PathStore.h>
+#include <PathSweep.h>
+#include <ConversionStats.h>
+#include <Path.h>
+#include <Point.h>
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A highway waiting to be turned into paths
+struct highway
+{
+	int64_t id;
+	std::vector<int64_t> refs;
+	std::string name;               // UTF-8
+	pathflow flow;
+	float speedlimit;
+};
+
+// A tile of the output grid. The edges are in whole network coordinates
+// and the paths in the tile's own coordinates.
+struct maptile
+{
+	float left, top, right, bottom;
+	long int width, height;
+	PathStore paths;
+	unsigned long long bytes;       // Bytes written to the tile's file
+};
+
+// Options of the output network
+struct network_options
+{
+	long int map_width = 0;
+	long int map_height = 0;
+	long int defaultspeed = DEFAULT_SPEED;
+	long int precision = MOBSINKWRITER_PRECISION;
+	outputformat format = OUTPUT_XML;
+	long int tile_rows = 0;
+	long int tile_columns = 0;
+	long int threads = 0;           // Used to write the output (or the tiles)
+	crossingmode crossings = CROSSINGS_IGNORE;
+	projectiontype projection = PROJECTION_EQUIRECTANGULAR;
+};
+
+// This class turns highways into the paths of a MobSink network and
+// writes them to an output file (or to a grid of tiles, or to a writer
+// of the caller). The nodes are projected from the map boundaries to the
+// network size, a highway at a time. When crossings are looked for, the
+// paths are kept until the network is finished.
+class NetworkBuilder
+{
+public:
+	void SetBounds(const osm_bounds &bounds);
+	bool IsInside(double lat, double lon);
+
+	bool Open(const std::string &output);
+	bool Open(NetworkWriter *writer);
+	bool Finish(void);
+	void Close(bool ok);
+
+	void BuildHighway(const highway &road, std::vector<Point> &points);
+	void BuildHighway(const highway &road, std::vector<int64_t> &ids, std::vector<Point> &points);
+	void ProjectHighway(const std::vector<node_location> &locations, std::vector<Point> &points);
+	void WriteHighway(const highway &road, const std::vector<Point> &points);
+	void WritePath(Path &path);
+	void CheckCrossings(PathStore &paths);
+	Point Project(const node_location &location);
+	void ProjectNodes(const node_location *locations, size_t count, float *x, float *y);
+	NetworkWriter *CreateWriter(FILE *fp, long int threads);
+
+	static void GetMapSize(projectiontype projection, double lat_a, double lon_a, double lat_b, double lon_b,
+			long int &width, long int &height);
+
+	network_options options;
+	double minlat = 0, maxlat = 0, minlon = 0, maxlon = 0;
+
+	// Conversion data (owned by the caller)
+	NodeIndex *nodes = NULL;
+	Simplifier *simplifier = NULL;
+	stats_counters *counters = NULL;
+	FILE *messages = stdout;        // Summaries and the crossings report
+
+private:
+	void OutputPath(Path &path);
+	void BeginTiles(void);
+	void ClipPath(Path &path);
+	bool WriteTiles(void);
+	bool WriteTile(maptile &tile, const std::string &output);
+
+	std::string output;
+	FILE *outputfile = NULL;
+	NetworkWriter *writer = NULL;
+	std::unique_ptr<NetworkWriter> ownwriter;   // The writer of the output file
+	std::vector<maptile> tiles;
+	PathStore pending;              // Paths waiting for the crossings to be found
+	Projection projection;
+	bool projection_ready = false;  // Set up for the current boundaries and size
+	std::vector<node_location> locations;
+	std::vector<float> projected_x, projected_y;
+};
+
+#endif /* INCLUDE_NETWORKBUILDER_H_ */
@@ -0,0 +1,38 @@
+/*
+ * MobSink network writer interface.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_NETWORKWRITER_H_
+#define INCLUDE_NETWORKWRITER_H_
+
+#include <Path.h>
+
+// Writes a MobSink network one path at a time, in some output format.
+// Begin() must be called before the first path and End() after the last.
+class NetworkWriter
+{
+public:
+	virtual ~NetworkWriter() {}
+
+	virtual void Begin(long width, long height, long speedlimit) = 0;
+	virtual void Write(Path &path) = 0;
+	virtual bool End(void) = 0;
+	virtual bool IsStarted(void) = 0;
+	virtual unsigned long long GetBytesWritten(void) = 0;
+};
+
+#endif /* INCLUDE_NETWORKWRITER_H_ */
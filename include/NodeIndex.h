@@ -0,0 +1,95 @@
+/*
+ * Node location index declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_NODEINDEX_H_
+#define INCLUDE_NODEINDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Fixed point coordinates use 1e-7 degrees, the precision of OSM data
+#define NODEINDEX_SCALE 1e7
+
+// Use a dense table when it needs at most this many slots per node
+#define NODEINDEX_DENSITY 2
+
+// Empty slots of the dense table
+#define NODEINDEX_EMPTY INT32_MIN
+
+// Location of a node in fixed point degrees
+struct node_location
+{
+	int32_t lat;
+	int32_t lon;
+};
+
+// This class maps 64-bit node ids to their locations. Nodes are appended
+// to a flat array which is sorted (if needed) on the first lookup. If the
+// ids turn out to be dense enough, the array is replaced by a table
+// indexed directly by the id. An index shared by threads must be prepared
+// with Prepare() before they look it up, so that none of them changes it.
+class NodeIndex
+{
+public:
+	NodeIndex();
+
+	void Insert(int64_t id, double lat, double lon);
+	bool Find(int64_t id, node_location &location);
+	void Remove(int64_t id);
+	void Clear(void);
+	void Prepare(void);
+	size_t GetSize(void);
+	bool IsDense(void);
+
+	static int32_t ToFixed(double degrees);
+	static double ToDegrees(int32_t fixed);
+
+	// Call visit(id, location) for every node, in id order
+	template <typename F>
+	void ForEach(F visit)
+	{
+		if (!this->prepared)
+			Prepare();
+
+		for (size_t i = 0; i < this->table.size(); i++)
+		{
+			if (this->table[i].lat != NODEINDEX_EMPTY)
+				visit(this->first + (int64_t)i, this->table[i]);
+		}
+
+		for (size_t i = 0; i < this->entries.size(); i++)
+			visit(this->entries[i].id, this->entries[i].location);
+	}
+
+private:
+	struct node_entry
+	{
+		int64_t id;
+		node_location location;
+	};
+
+	std::vector<node_entry> entries;        // Sparse index (sorted by id once prepared)
+	std::vector<node_location> table;       // Dense index (slot = id - first)
+	int64_t first;
+	size_t count;
+	bool sorted;
+	bool prepared;
+};
+
+#endif /* INCLUDE_NODEINDEX_H_ */
@@ -0,0 +1,54 @@
+/*
+ * Node id set declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_NODESET_H_
+#define INCLUDE_NODESET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Use a bitset when it needs at most this many bits per id
+#define NODESET_DENSITY 64
+
+// This class keeps a set of 64-bit node ids. Ids are appended to an array
+// which is sorted and deduplicated as it grows and on the first lookup.
+// If the ids are dense enough, the array is replaced by a bitset.
+class NodeSet
+{
+public:
+	NodeSet();
+
+	void Insert(int64_t id);
+	bool Contains(int64_t id);
+	void Clear(void);
+	size_t GetSize(void);
+
+private:
+	void Compact(void);
+	void Prepare(void);
+
+	std::vector<int64_t> ids;       // Sorted up to the compacted size
+	std::vector<uint64_t> bits;     // Bitset (bit = id - first)
+	int64_t first;
+	size_t compacted;
+	size_t count;
+	bool prepared;
+};
+
+#endif /* INCLUDE_NODESET_H_ */
@@ -0,0 +1,61 @@
+/*
+ * On-disk node store declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_NODESTORE_H_
+#define INCLUDE_NODESTORE_H_
+
+#include <NodeIndex.h>
+#include <MobSinkBinary.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// This class keeps the locations of the nodes in a file, as an array
+// indexed by the node id, for maps with more nodes than fit in memory.
+// The nodes are written while they are read (in id order in OSM files,
+// so the file is written sequentially), and the file is then mapped to
+// memory to be looked up. Ids that are skipped leave holes, which most
+// file systems don't store. Negative ids (new nodes in editor files) are
+// kept in memory.
+class NodeStore
+{
+public:
+	NodeStore();
+	~NodeStore();
+
+	bool Open(const std::string &filename, size_t memory);
+	void Insert(int64_t id, double lat, double lon);
+	bool Finish(void);
+	bool Find(int64_t id, node_location &location);
+	void Close(void);
+
+private:
+	bool Flush(void);
+
+	std::string filename;
+	FILE *file;
+	MobSinkBinaryFile mapping;
+	std::vector<node_location> run;         // Consecutive nodes waiting to be written
+	int64_t run_first;                      // Id of the first node of the run
+	size_t capacity;                        // Nodes in a run
+	NodeIndex negative;
+	bool ok;
+};
+
+#endif /* INCLUDE_NODESTORE_H_ */
@@ -19,25 +19,24 @@
 #ifndef INCLUDE_OSM2MOBSINKAPP_H_
 #define INCLUDE_OSM2MOBSINKAPP_H_
 
-#define DEFAULT_SPEED 50
-
 #include <wx/wx.h>
 #include <wx/cmdline.h>
+#include <wx/init.h>
+#include <Converter.h>
 
-class OSM2MobSinkApp: public wxApp
+// The command line front end: it reads the arguments into the settings of
+// a Converter (or a batch) and runs it. There is no wxApp: main() only
+// initializes wxWidgets for the command line parser's messages.
+class OSM2MobSinkApp
 {
+public:
+	int Run(int argc, char **argv);
+
 private:
-	bool OnInit();
-	virtual void OnInitCmdLine(wxCmdLineParser& parser);
-	virtual bool OnCmdLineParsed(wxCmdLineParser& parser);
-	bool Convert(wxString input, wxString output);
-	wxSize GetMapSize(float lat_a, float lon_a, float lat_b, float lon_b);
-
-	wxString inputfile;
-	wxString outputfile;
-	long int map_width = 0;
-	long int map_height = 0;
-	long int defaultspeed = DEFAULT_SPEED;
+	bool OnCmdLineParsed(wxCmdLineParser& parser);
+
+	Converter converter;
+	wxString batchfile;
 };
 
 // Command line arguments
@@ -45,15 +44,31 @@ static const wxCmdLineEntryDesc g_cmdLineDesc[] =
 {
 	{ wxCMD_LINE_SWITCH, ("h"),  ("help"),   ("displays help on the command line parameters"), wxCMD_LINE_VAL_NONE,	wxCMD_LINE_OPTION_HELP },
 
-	{ wxCMD_LINE_OPTION, ("i"),  ("input"),  ("load OSM XML data from input file") },
+	{ wxCMD_LINE_OPTION, ("i"),  ("input"),  ("load OSM XML or PBF (.osm.pbf) data from input file (may be .gz or .bz2)") },
 	{ wxCMD_LINE_OPTION, ("o"),  ("output"), ("save MobSink XML network to output file") },
 	{ wxCMD_LINE_OPTION, ("nw"), ("width"),	 ("set the default MobSink network width"), wxCMD_LINE_VAL_NUMBER },
 	{ wxCMD_LINE_OPTION, ("nh"), ("height"), ("set the default MobSink network height"), wxCMD_LINE_VAL_NUMBER },
 	{ wxCMD_LINE_OPTION, ("s"),  ("speed"),  ("set the default MobSink network speed limit (default: 50)"), wxCMD_LINE_VAL_NUMBER },
+	{ wxCMD_LINE_OPTION, ("t"),  ("threads"), ("number of threads used to read the input (default: 1 for XML, one per core for PBF) and to write the output (default: one per core)"), wxCMD_LINE_VAL_NUMBER },
+	{ wxCMD_LINE_OPTION, ("p"),  ("precision"), ("number of decimal digits of the output coordinates (default: 6)"), wxCMD_LINE_VAL_NUMBER },
+	{ wxCMD_LINE_OPTION, ("sp"), ("simplify"), ("simplify the ways, removing nodes closer than this to the road (in MobSink units)"), wxCMD_LINE_VAL_DOUBLE },
+	{ wxCMD_LINE_SWITCH, ("tp"), ("two-pass"), ("read the input twice to keep only the nodes used by highways (saves memory)") },
+	{ wxCMD_LINE_OPTION, ("f"),  ("format"), ("output format: xml (MobSink XML, default) or bin (memory-mappable binary)") },
+	{ wxCMD_LINE_SWITCH, ("ni"), ("network-input"), ("the input is a MobSink network (XML or binary) to be converted to the output format") },
+	{ wxCMD_LINE_OPTION, ("st"), ("stats"), ("write timings, counters and memory usage of the conversion to a JSON file") },
+	{ wxCMD_LINE_OPTION, ("tl"), ("tiles"), ("split the network into a grid of RxC tiles, written to output_ROW_COLUMN files") },
+	{ wxCMD_LINE_OPTION, ("b"),  ("batch"), ("run the conversions listed in a manifest file (input output [width [height [speed]]] per line) in parallel") },
+	{ wxCMD_LINE_OPTION, ("c"),  ("cache"), ("keep what is read from the input in this directory, so later runs with the same input don't read it again") },
+	{ wxCMD_LINE_OPTION, ("sf"), ("state"), ("save the conversion state to a file, so that OSM change files can be applied to it later") },
+	{ wxCMD_LINE_OPTION, ("cx"), ("crossings"), ("find paths that cross without a shared node: report (list them) or split (split the paths there)") },
+	{ wxCMD_LINE_OPTION, ("pj"), ("projection"), ("map projection: equirectangular (default), mercator (Web Mercator) or tm (transverse Mercator)") },
+	{ wxCMD_LINE_OPTION, ("r"),  ("rules"), ("read the kept highway classes, their speed limits, one-way values and speed units from a rules file") },
+	{ wxCMD_LINE_OPTION, ("mc"), ("min-component"), ("drop the groups of connected roads with less than this number of nodes"), wxCMD_LINE_VAL_NUMBER },
+	{ wxCMD_LINE_SWITCH, ("ct"), ("contract"), ("merge the roads between junctions into single paths when they have the same name, flow and speed limit") },
+	{ wxCMD_LINE_OPTION, ("ml"), ("memory-limit"), ("slim mode: keep the nodes and highways in files next to the output, using about this many MB of memory"), wxCMD_LINE_VAL_NUMBER },
+	{ wxCMD_LINE_OPTION, ("ac"), ("apply-changes"), ("apply an OSM change file (.osc) to the state given with --state and write the updated network") },
 
 	{ wxCMD_LINE_NONE }
 };
 
-IMPLEMENT_APP(OSM2MobSinkApp)
-
 #endif /* INCLUDE_OSM2MOBSINKAPP_H_ */
@@ -0,0 +1,163 @@
+/*
+ * OpenStreetMap XML streaming reader declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_OSMREADER_H_
+#define INCLUDE_OSMREADER_H_
+
+#include <InputStream.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Size of the blocks read from the input file
+#define OSMREADER_BLOCK_SIZE (1 << 20)
+
+// Size of the chunks parsed by each thread in parallel mode
+#define OSMREADER_CHUNK_SIZE (8 << 20)
+
+// Map boundaries
+struct osm_bounds
+{
+	double minlat;
+	double minlon;
+	double maxlat;
+	double maxlon;
+};
+
+// A single node
+struct osm_node
+{
+	int64_t id;
+	double lat;
+	double lon;
+};
+
+// A key/value pair attached to a way
+struct osm_tag
+{
+	std::string key;
+	std::string value;
+};
+
+// A way with its node references and tags
+struct osm_way
+{
+	int64_t id;
+	std::vector<int64_t> refs;
+	std::vector<osm_tag> tags;
+};
+
+// Element types
+enum osm_element
+{
+	OSM_BOUNDS,
+	OSM_NODE,
+	OSM_WAY,
+};
+
+// Actions of an OSM change file
+enum osm_action
+{
+	OSM_CREATE,
+	OSM_MODIFY,
+	OSM_DELETE,
+};
+
+// A sequence of elements decoded in the background. The order vector
+// keeps the document order of the elements stored in the other ones.
+struct osm_block
+{
+	bool ok;
+	std::vector<osm_bounds> bounds;
+	std::vector<osm_node> nodes;
+	std::vector<osm_way> ways;
+	std::vector<unsigned char> order;
+};
+
+// Receives the map elements as the reader finds them. The objects passed
+// to the handler are only valid during the call.
+class OSMHandler
+{
+public:
+	virtual ~OSMHandler() {}
+
+	virtual void OnBounds(const osm_bounds &bounds) {}
+	virtual void OnNode(const osm_node &node) {}
+	virtual void OnWay(const osm_way &way) {}
+	virtual void OnAction(osm_action action) {}
+};
+
+// This class reads an OpenStreetMap XML file one block at a time and
+// reports <bounds>, <node> and <way> elements (with their <nd> and <tag>
+// children) to an OSMHandler, without ever building the whole document.
+// With more than one thread, the file is split at the lines starting a
+// <node>, <way> or <relation> and the chunks are parsed in parallel, but
+// the elements are still reported in document order.
+// An OSM change file (<osmChange>) is read the same way, with OnAction()
+// called before the elements of each <create>, <modify> or <delete>.
+// Change files must be read with a single thread.
+class OSMReader
+{
+public:
+	OSMReader(OSMHandler *handler, unsigned int threads = 1);
+
+	bool Parse(FILE *fp);
+	bool Parse(InputStream &input);
+	bool Parse(const char *data, size_t size);
+	bool ParseFragment(const char *data, size_t size, bool first, bool last);
+
+	static void Dispatch(const osm_block &block, OSMHandler *handler);
+	static std::string_view DecodeValue(const char *data, size_t size, std::string &out);
+
+private:
+	// The name and value point into the parsed data, unless the value had
+	// to be decoded
+	struct xml_attribute
+	{
+		std::string_view name;
+		std::string_view value;
+		std::string decoded;
+	};
+
+	void Reset(void);
+	bool ParseChunks(InputStream &input);
+	size_t ParseBlock(const char *data, size_t size, bool last);
+	void ParseElement(const char *data, size_t size);
+	void StartElement(const std::string &name, bool empty);
+	void EndElement(const std::string &name);
+	const std::string_view *GetAttribute(const char *name);
+
+	OSMHandler *handler;
+	unsigned int threads;
+	bool ok;
+	bool root;
+	size_t level;                       // Depth of the map elements (2 in change files)
+	std::string element;                // Name of the current element (reused)
+	std::vector<std::string> stack;     // Names of the open elements
+	std::deque<xml_attribute> attrs;    // Attributes of the current element (reused). A deque
+	                                    // doesn't move them as it grows, so the values that
+	                                    // point to their decoded strings stay valid.
+	size_t nattrs;
+	bool in_way;
+	osm_way way;                        // The way being read (reused)
+};
+
+#endif /* INCLUDE_OSMREADER_H_ */
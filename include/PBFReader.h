@@ -0,0 +1,51 @@
+/*
+ * OpenStreetMap PBF reader declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_PBFREADER_H_
+#define INCLUDE_PBFREADER_H_
+
+#include <OSMReader.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Format limits (from the OSM PBF specification)
+#define PBF_MAX_HEADER_SIZE (64 * 1024)
+#define PBF_MAX_BLOB_SIZE (32 * 1024 * 1024)
+
+// This class reads an OpenStreetMap PBF file and reports its elements to
+// an OSMHandler, in file order. The blobs are independent from each other,
+// so they are decompressed and decoded by a pool of threads while the
+// handler consumes the ones already finished.
+class PBFReader
+{
+public:
+	PBFReader(OSMHandler *handler, unsigned int threads = 0);
+
+	bool Parse(FILE *fp);
+	bool Parse(InputStream &input);
+
+	static bool DecodeHeader(const std::string &blob, osm_bounds &bounds, bool &has_bounds);
+	static void DecodeBlock(const std::string &blob, osm_block &block);
+
+private:
+	OSMHandler *handler;
+	unsigned int threads;
+};
+
+#endif /* INCLUDE_PBFREADER_H_ */
@@ -0,0 +1,61 @@
+/*
+ * Parse cache declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_PARSECACHE_H_
+#define INCLUDE_PARSECACHE_H_
+
+#include <NodeIndex.h>
+#include <OSMReader.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define PARSECACHE_MAGIC "O2MCACHE"
+#define PARSECACHE_VERSION 1
+
+// A highway as read from the input
+struct cache_way
+{
+	int64_t id;
+	std::vector<int64_t> refs;
+	std::string name;               // UTF-8
+	int flow;                       // pathflow
+	float speedlimit;
+};
+
+// This class keeps what was read from an OSM file that doesn't depend on
+// the conversion options: the boundaries, the highways and the locations
+// of the nodes they use. Cache files are named after a hash of the input
+// contents, so a changed input never matches an old cache.
+class ParseCache
+{
+public:
+	ParseCache();
+
+	bool Save(FILE *fp, NodeIndex &nodes);
+	bool Load(FILE *fp, NodeIndex &nodes);
+
+	static uint64_t Hash(FILE *fp);
+
+	uint64_t key;                   // Hash of the input
+	osm_bounds bounds;
+	std::vector<cache_way> ways;    // In input order
+};
+
+#endif /* INCLUDE_PARSECACHE_H_ */
@@ -0,0 +1,89 @@
+/*
+ * PathIndex class declarations.
+ * Copyright (C) 2015-2018 João Paulo Just Peixoto <just1982@gmail.com>.
+ *
+ * This file is part of MobSink.
+ *
+ * MobSink is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MobSink is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MobSink.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHINDEX_H
+#define PATHINDEX_H
+
+#include "Path.h"
+#include "Point.h"
+#include <vector>
+
+using namespace std;
+
+// Average number of paths per grid cell when the cell size is automatic
+#define PATHINDEX_PATHS_PER_CELL 2
+
+// A path found by a nearest point query
+struct path_nearest
+{
+    unsigned int path;      // Index of the path
+    Point point;            // Nearest point inside the path
+    float distance;
+};
+
+// A crossing between two paths
+struct path_crossing
+{
+    unsigned int a;         // Index of the first path
+    unsigned int b;         // Index of the second path (or of the query segment)
+    Point point;
+};
+
+// This class indexes a set of paths in a uniform grid, so that the paths
+// near a point or crossing a segment can be found without testing all
+// of them. The distances and intersections are computed by the Path
+// methods. The paths must not change while they are indexed.
+class PathIndex
+{
+public:
+    PathIndex();
+    PathIndex(vector<Path> &paths, float cellsize = 0);
+    void Build(vector<Path> &paths, float cellsize = 0);
+
+    void GetNearest(Point p, unsigned int k, vector<path_nearest> &result);
+    void GetNearest(vector<Point> &points, unsigned int k, vector<vector<path_nearest> > &result, unsigned int threads = 1);
+    void GetCrossings(Path r, vector<path_crossing> &result);
+    void GetCrossings(vector<Path> &segments, vector<path_crossing> &result, unsigned int threads = 1);
+    void GetAllCrossings(vector<path_crossing> &result, unsigned int threads = 1);
+
+    float GetCellSize(void);
+
+private:
+    // Per query scratch memory (one per thread)
+    struct query_scratch
+    {
+        vector<unsigned int> stamp;     // Last query that tested each path
+        unsigned int query;
+    };
+
+    void GetNearest(Point p, unsigned int k, vector<path_nearest> &result, query_scratch &scratch);
+    void GetCrossings(Path r, unsigned int id, bool indexed, vector<path_crossing> &result, query_scratch &scratch);
+    void GetCells(float xa, float ya, float xb, float yb, int &ca, int &ra, int &cb, int &rb);
+    bool NextQuery(query_scratch &scratch);
+
+    vector<Path> *paths;
+    float minx, miny;
+    float cellsize;
+    int columns, rows;
+    vector<unsigned int> cell_start;    // Paths of cell i are cell_paths[cell_start[i], cell_start[i + 1])
+    vector<unsigned int> cell_paths;
+};
+
+#endif // PATHINDEX_H
@@ -0,0 +1,82 @@
+/*
+ * PathStore class declarations.
+ * Copyright (C) 2015-2018 João Paulo Just Peixoto <just1982@gmail.com>.
+ *
+ * This file is part of MobSink.
+ *
+ * MobSink is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MobSink is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MobSink.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHSTORE_H
+#define PATHSTORE_H
+
+#include "Path.h"
+#include <stddef.h>
+#include <vector>
+
+// A row of the control table
+struct pathstore_control
+{
+    int time;
+    struct path_control_params params;
+};
+
+// This class stores many paths as a structure of arrays: the end points
+// are kept in contiguous float arrays, the names are interned and the
+// control parameters of all paths share a single table. The batch
+// kernels work on all the paths at once and agree with the Path methods
+// within PATHSTORE_TOLERANCE (Path::HasPoint allows a 1 pixel error).
+#define PATHSTORE_TOLERANCE 1.0f
+
+class PathStore
+{
+public:
+    PathStore();
+
+    size_t Add(Path &path);
+    size_t Add(float xa, float ya, float xb, float yb, pathflow flow = PATHFLOW_BI, wxString name = wxEmptyString);
+    void InsertControl(int time, float speedlimit, float traffic, bool blocked);
+    void Reserve(size_t size);
+    void Clear(void);
+
+    size_t GetSize(void);
+    Path GetPath(size_t i);
+    pathflow GetFlow(size_t i);
+    unsigned int GetNameId(size_t i);
+    wxString GetName(unsigned int id);
+    size_t GetControlCount(size_t i);
+    const pathstore_control *GetControl(size_t i);
+
+    const float *GetXA(void);
+    const float *GetYA(void);
+    const float *GetXB(void);
+    const float *GetYB(void);
+
+    // Batch kernels (the output arrays must hold GetSize() values)
+    void GetLenghts(float *lenght);
+    void GetProjections(Point p, float *x, float *y);
+    void GetNearestPoints(Point p, float *x, float *y, float *distance);
+    size_t GetNearest(Point p, Point &nearest, float &distance);
+
+private:
+    vector<float> xa, ya, xb, yb;
+    vector<unsigned char> flow;
+    vector<unsigned int> name;              // Index in names
+    vector<wxString> names;                 // Interned names (0 is the empty name)
+    map<wxString, unsigned int> name_ids;
+    vector<size_t> control_start;           // First row of each path in control (plus the end)
+    vector<pathstore_control> control;
+};
+
+#endif // PATHSTORE_H
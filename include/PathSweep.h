@@ -0,0 +1,94 @@
+/*
+ * PathSweep class declarations.
+ * Copyright (C) 2015-2018 João Paulo Just Peixoto <just1982@gmail.com>.
+ *
+ * This file is part of MobSink.
+ *
+ * MobSink is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MobSink is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MobSink.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHSWEEP_H
+#define PATHSWEEP_H
+
+#include "PathIndex.h"
+#include "PathStore.h"
+#include <functional>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+// Distance (relative to the size of the network) within which a point is
+// taken to be on a path
+#define PATHSWEEP_EPSILON 1e-12
+
+// This class finds the crossings of a set of paths with a sweep line
+// (Bentley-Ottmann), which only tests paths that are neighbours on the
+// sweep line instead of all the pairs.
+// Two paths cross when they meet at a point that is not an end point of
+// both: paths that cross in the middle, a path that ends in the middle of
+// another and paths that overlap. Paths that only meet at end points of
+// both are connected and are not reported. Each pair is reported once;
+// paths that overlap are reported at the first point of the overlap that
+// is not an end point of both.
+// The end points are compared exactly and the ordering of the paths uses
+// their directions instead of slopes, so vertical paths need no special
+// case. Only the crossing points themselves are rounded.
+class PathSweep
+{
+public:
+    PathSweep(PathStore &paths);
+
+    void GetCrossings(vector<path_crossing> &result);
+
+    static void Split(PathStore &paths, vector<path_crossing> &crossings, PathStore &result);
+
+private:
+    // A path with its end points in sweep order (left to right, then bottom to top)
+    struct sweep_segment
+    {
+        double xa, ya, xb, yb;
+        unsigned int path;              // Index in the path store
+    };
+
+    typedef pair<double, double> sweep_point;
+
+    // An end point of a path
+    struct sweep_end
+    {
+        sweep_point point;
+        unsigned int segment;
+        bool starting;
+    };
+
+    void HandleEvent(const sweep_point &p, vector<path_crossing> &result);
+    void CheckPair(size_t lower, const sweep_point &p);
+    double GetY(unsigned int s, const sweep_point &p);
+    bool Contains(unsigned int s, const sweep_point &p);
+    bool IsEndPoint(unsigned int s, const sweep_point &p);
+    bool IsBelow(unsigned int s, unsigned int t);
+
+    vector<sweep_segment> segments;         // Sorted by their first end point
+    vector<sweep_end> ends;                 // Sorted by point
+    priority_queue<sweep_point, vector<sweep_point>, greater<sweep_point> > crossings;  // Found ahead of the sweep line
+    vector<unsigned int> status;            // Paths crossing the sweep line, bottom to top
+    vector<char> active;                    // Paths in status
+    vector<unsigned int> starting, ending;  // Paths starting and ending at the event
+    vector<unsigned int> through, inserted; // Event scratch
+    unordered_set<unsigned long long> reported; // Pairs already reported
+    double epsilon;
+};
+
+#endif // PATHSWEEP_H
@@ -0,0 +1,120 @@
+/*
+ * Map projection declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_PROJECTION_H_
+#define INCLUDE_PROJECTION_H_
+
+#include <NodeIndex.h>
+#include <math.h>
+#include <stddef.h>
+
+// Radius of the sphere used by Web Mercator and transverse Mercator (meters)
+#define PROJECTION_RADIUS 6378137.0
+
+// Map projections
+enum projectiontype
+{
+	PROJECTION_EQUIRECTANGULAR,     // Meters per degree at the middle latitude (default)
+	PROJECTION_MERCATOR,            // Web Mercator, scaled to meters at the middle latitude
+	PROJECTION_TRANSVERSE_MERCATOR, // Spherical transverse Mercator around the middle longitude
+};
+
+// Each projection turns degrees into meters around the middle of the map.
+// Forward() is called for every node, so it must be inlined.
+struct EquirectangularProjection
+{
+	void Setup(double lat, double lon)
+	{
+		this->x_scale = cos(fabs(lat) * (M_PI / 180)) * 111320;
+	}
+
+	void Forward(double lat, double lon, double &x, double &y) const
+	{
+		x = lon * this->x_scale;
+		y = lat * 110574;
+	}
+
+	double x_scale;
+};
+
+struct MercatorProjection
+{
+	void Setup(double lat, double lon)
+	{
+		this->scale = PROJECTION_RADIUS * cos(lat * (M_PI / 180));
+	}
+
+	void Forward(double lat, double lon, double &x, double &y) const
+	{
+		x = this->scale * lon * (M_PI / 180);
+		y = this->scale * log(tan(M_PI / 4 + lat * (M_PI / 360)));
+	}
+
+	double scale;
+};
+
+struct TransverseMercatorProjection
+{
+	void Setup(double lat, double lon)
+	{
+		this->lon0 = lon;
+	}
+
+	void Forward(double lat, double lon, double &x, double &y) const
+	{
+		double phi = lat * (M_PI / 180), lambda = (lon - this->lon0) * (M_PI / 180);
+		x = PROJECTION_RADIUS * atanh(cos(phi) * sin(lambda));
+		y = PROJECTION_RADIUS * atan2(tan(phi), cos(lambda));
+	}
+
+	double lon0;
+};
+
+// This class projects node locations to MobSink coordinates: the map
+// boundaries are projected and their extent is scaled to the network
+// size, with y starting from the top. Nodes are projected in batches by a
+// kernel instantiated for each projection, so the type is only looked at
+// once per batch and the loop has no calls left in it.
+class Projection
+{
+public:
+	Projection();
+
+	void Setup(projectiontype type, double minlat, double maxlat, double minlon, double maxlon, double width, double height);
+	void Project(const node_location *locations, size_t count, float *x, float *y) const;
+
+	static void GetSize(projectiontype type, double minlat, double maxlat, double minlon, double maxlon, double &width, double &height);
+
+private:
+	template <class P>
+	static void SetupExtent(P &projection, double minlat, double maxlat, double minlon, double maxlon,
+			double &left, double &top, double &right, double &bottom);
+
+	template <class P>
+	void Run(const P &projection, const node_location *locations, size_t count, float *x, float *y) const;
+
+	projectiontype type;
+	EquirectangularProjection equirectangular;
+	MercatorProjection mercator;
+	TransverseMercatorProjection transverse;
+	double left, top;               // Projected corner of the network origin
+	double x_scale, y_scale;        // Network units per meter
+	double width, height;           // Network size
+};
+
+#endif /* INCLUDE_PROJECTION_H_ */
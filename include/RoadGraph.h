@@ -0,0 +1,79 @@
+/*
+ * Road graph declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_ROADGRAPH_H_
+#define INCLUDE_ROADGRAPH_H_
+
+#include <NetworkBuilder.h>
+#include <Point.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+// A segment of a highway between two nodes (indices in the graph). One-way
+// segments go from a to b.
+struct graph_edge
+{
+	uint32_t a;
+	uint32_t b;
+	uint32_t road;                  // Tags of the highway (index in roads)
+	bool alive;
+};
+
+// This class keeps the highways as a graph whose vertices are the OSM
+// nodes, so that the junctions are known. Once all the highways were
+// added, Build() lays out the adjacency in compressed sparse row form:
+// the edges of node n are adjacency[first[n]] up to adjacency[first[n + 1]].
+// The graph can then lose its small components (found with union-find)
+// and have its chains of degree 2 nodes merged into single edges.
+class RoadGraph
+{
+public:
+	void AddHighway(const highway &road, const std::vector<int64_t> &ids, const std::vector<Point> &points);
+	void Build(void);
+	size_t Prune(size_t min_nodes, size_t &components);
+	size_t Contract(void);
+	void Write(NetworkBuilder &builder);
+	void Clear(void);
+
+	size_t GetNodeCount(void);
+	size_t GetEdgeCount(void);
+
+private:
+	struct graph_node
+	{
+		int64_t id;
+		Point point;
+	};
+
+	uint32_t Find(std::vector<uint32_t> &parent, uint32_t n);
+	bool IsChainNode(uint32_t n, uint32_t &in, uint32_t &out);
+	uint32_t GetRoad(const highway &road);
+
+	std::vector<graph_node> added;          // Nodes as added (until built)
+	std::vector<int64_t> edge_ids;          // Node ids of the edges (until built)
+	std::vector<int64_t> ids;               // Sorted node ids
+	std::vector<Point> points;              // Location of each node
+	std::vector<graph_edge> edges;          // In the order they were added
+	std::vector<uint32_t> first;            // CSR offsets (one per node, plus the end)
+	std::vector<uint32_t> adjacency;        // Edges of each node
+	std::vector<highway> roads;             // Distinct tags (the refs are empty)
+	std::map<std::pair<std::pair<std::string, int>, float>, uint32_t> road_ids;
+};
+
+#endif /* INCLUDE_ROADGRAPH_H_ */
@@ -0,0 +1,54 @@
+/*
+ * Way simplification declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_SIMPLIFIER_H_
+#define INCLUDE_SIMPLIFIER_H_
+
+#include <NodeSet.h>
+#include <Point.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+// This class simplifies the shape of ways with the Douglas-Peucker
+// algorithm. The first and last nodes of a way and the nodes used more
+// than once (junctions with other ways) are never removed. Once prepared,
+// ways can be simplified from several threads at the same time.
+class Simplifier
+{
+public:
+	Simplifier(float tolerance);
+
+	void AddWay(const std::vector<int64_t> &refs);
+	void Prepare(void);
+	void Simplify(std::vector<int64_t> &ids, std::vector<Point> &points);
+
+	unsigned long GetSegments(void);
+	unsigned long GetRemoved(void);
+
+private:
+	void Reduce(std::vector<Point> &points, std::vector<bool> &keep, size_t first, size_t last);
+
+	float tolerance;
+	std::vector<int64_t> refs;      // All the nodes of the ways (until prepared)
+	NodeSet shared;                 // Nodes used more than once
+	std::atomic<unsigned long> segments;
+	std::atomic<unsigned long> removed;
+};
+
+#endif /* INCLUDE_SIMPLIFIER_H_ */
@@ -0,0 +1,97 @@
+/*
+ * Slim mode store declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_SLIMSTORE_H_
+#define INCLUDE_SLIMSTORE_H_
+
+#include <NodeStore.h>
+#include <ExternalSorter.h>
+#include <NetworkBuilder.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A reference of a highway to a node
+struct slim_ref
+{
+	int64_t id;
+	uint32_t way;                           // Order of the highway in the input
+	uint32_t position;                      // Order of the node in the highway
+};
+
+// A node of a highway, once found
+struct slim_node
+{
+	uint32_t way;
+	uint32_t position;
+	node_location location;
+};
+
+// This class keeps what is read from a map on disk, so that maps with more
+// nodes than fit in memory can be converted (slim mode). The nodes go to a
+// NodeStore, the highways to a file and their node references to an
+// external sort. Once everything was read, the references are sorted by
+// node id and joined with the nodes, which reads the node file in order,
+// and the nodes found are sorted back into the highways. The memory used
+// is about the given size, plus what the system caches of the files.
+class SlimStore
+{
+public:
+	typedef std::function<void(highway &road, std::vector<node_location> &locations)> highway_function;
+
+	SlimStore(const std::string &prefix, size_t memory);
+	~SlimStore();
+
+	bool Open(void);
+	void AddNode(int64_t id, double lat, double lon);
+	void AddHighway(const highway &road);
+	bool ForEach(highway_function visit, unsigned long long &missing);
+	void Close(void);
+
+private:
+	bool ReadHighway(highway &road);
+
+	struct by_id
+	{
+		bool operator()(const slim_ref &a, const slim_ref &b) const
+		{
+			return a.id < b.id;
+		}
+	};
+
+	struct by_way
+	{
+		bool operator()(const slim_node &a, const slim_node &b) const
+		{
+			return (a.way < b.way) || ((a.way == b.way) && (a.position < b.position));
+		}
+	};
+
+	std::string prefix;
+	size_t memory;
+	NodeStore nodes;
+	FILE *highways;                         // The highways without their references
+	uint32_t count;                         // Highways added
+	ExternalSorter<slim_ref, by_id> refs;
+	ExternalSorter<slim_node, by_way> found;
+	bool ok;
+};
+
+#endif /* INCLUDE_SLIMSTORE_H_ */
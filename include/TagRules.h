@@ -0,0 +1,81 @@
+/*
+ * Highway tag rules declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_TAGRULES_H_
+#define INCLUDE_TAGRULES_H_
+
+#include <NetworkBuilder.h>
+#include <OSMReader.h>
+#include <Path.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What a tag key means to the rules
+enum tagkind
+{
+	TAG_HIGHWAY,
+	TAG_ONEWAY,
+	TAG_MAXSPEED,
+	TAG_NAME,
+};
+
+// This class decides which ways are highways and reads their attributes
+// from their tags. The rules are read from a file with one rule per line:
+//
+//   highway CLASS [SPEED]      keep highways of this class (* for any other
+//                              class), with a speed limit for the ones
+//                              without maxspeed (0 for the network default)
+//   oneway VALUE forward|reverse
+//                              one-way value; reverse ways are turned around
+//   maxspeed UNIT FACTOR       maxspeed unit (like mph) and its value in km/h
+//
+// The fields are separated by tabs or spaces, and empty lines and lines
+// starting with '#' are skipped. Without a file, the rules are "highway *"
+// and "oneway yes forward". The same rules can also be given as a text.
+// The rules are compiled into hash tables, so each tag is classified by a
+// single lookup of its key, and a way is rejected as soon as its highway
+// class is found not to be kept.
+class TagRules
+{
+public:
+	TagRules();
+
+	bool Load(const std::string &filename);
+	bool Set(const std::string &rules);
+	bool ParseHighway(const osm_way &way, highway &road) const;
+
+	uint64_t key;                   // Hash of the rules (0 for the default rules)
+
+private:
+	void Clear(void);
+	bool Parse(const std::string &text, const std::string &source);
+	static bool ReadAll(FILE *fp, std::string &text);
+	float ParseSpeed(const std::string &value) const;
+
+	std::unordered_map<std::string, tagkind> keys;
+	std::unordered_map<std::string, float> classes;     // Speed limit of each class
+	bool any_class;
+	float any_speed;
+	std::unordered_map<std::string, bool> oneways;      // True for the reverse values
+	std::vector<std::pair<std::string, float> > units;  // Factor of each unit
+};
+
+#endif /* INCLUDE_TAGRULES_H_ */
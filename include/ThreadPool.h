@@ -0,0 +1,80 @@
+/*
+ * Thread pool declarations.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_THREADPOOL_H_
+#define INCLUDE_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads. Tasks submitted from outside the pool
+// are started in submission order. Tasks submitted by a running task go
+// to the deque of its worker, which runs the newest first, and idle
+// workers steal the oldest ones from the others before starting anything
+// new, so the work spawned by a task is finished early.
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+
+	unsigned int GetSize(void);
+	void Submit(std::function<void()> task);
+	void Wait(void);
+
+	// Submit a task and get a future to wait for its result
+	template <typename T>
+	std::future<T> Async(std::function<T()> task)
+	{
+		std::shared_ptr<std::packaged_task<T()> > job(new std::packaged_task<T()>(task));
+		std::future<T> result = job->get_future();
+		Submit([job]() { (*job)(); });
+		return result;
+	}
+
+	static unsigned int GetDefaultSize(void);
+
+private:
+	struct worker_queue
+	{
+		std::mutex lock;
+		std::deque<std::function<void()> > tasks;
+	};
+
+	void Run(unsigned int index);
+	bool Take(unsigned int index, std::function<void()> &task);
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<worker_queue> > queues;    // One per worker
+	std::deque<std::function<void()> > tasks;              // Submitted from outside
+	std::mutex lock;
+	std::condition_variable task_ready;
+	std::condition_variable task_done;
+	std::atomic<unsigned int> pending;                      // Queued tasks
+	unsigned int unfinished;                                // Queued or running tasks
+	bool stop;
+};
+
+#endif /* INCLUDE_THREADPOOL_H_ */
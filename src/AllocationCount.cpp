@@ -0,0 +1,116 @@
+/*
+ * Allocation counting for the conversion statistics.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file replaces the global allocation operators, so only the programs
+// (the command line and the benchmark) build it; the library doesn't.
+
+#include <ConversionStats.h>
+#include <new>
+#include <stdlib.h>
+
+using namespace std;
+
+// The counters are constant initialized, so they can be used by the
+// allocations made before they are given to ConversionStats
+static stats_allocations counter = { { false }, { 0 }, { 0 } };
+
+// Give the counters to ConversionStats as the program starts
+static struct allocation_counter_setup
+{
+	allocation_counter_setup()
+	{
+		ConversionStats::SetAllocationCounter(&counter);
+	}
+} setup;
+
+// Global allocation operators. They only add a flag check to malloc and
+// free unless the allocations are being counted.
+void *operator new(size_t size)
+{
+	if (counter.counting.load(memory_order_relaxed))
+		counter.allocations.fetch_add(1, memory_order_relaxed);
+
+	void *p;
+	while ((p = malloc(size ? size : 1)) == NULL)
+	{
+		new_handler handler = get_new_handler();
+		if (!handler)
+			throw bad_alloc();
+
+		handler();
+	}
+
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	if (p && counter.counting.load(memory_order_relaxed))
+		counter.deallocations.fetch_add(1, memory_order_relaxed);
+
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	operator delete(p);
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+	try
+	{
+		return operator new(size);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+	return operator new(size, nothrow);
+}
+
+// The sized and nothrow forms must count as well, so they go to the
+// unsized one
+void operator delete(void *p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete(void *p, const nothrow_t &) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void *p, const nothrow_t &) noexcept
+{
+	operator delete(p);
+}
@@ -0,0 +1,306 @@
+/*
+ * Batch conversion.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <BatchRunner.h>
+#include <PBFReader.h>
+#include <wx/ffile.h>
+#include <map>
+#include <string.h>
+
+using namespace std;
+
+// Boundaries
+void BatchInput::OnBounds(const osm_bounds &bounds)
+{
+	this->bounds = bounds;
+	this->has_bounds = true;
+}
+
+// Nodes (only the ones inside the boundaries are kept)
+void BatchInput::OnNode(const osm_node &node)
+{
+	if (!this->has_bounds || (node.lat < this->bounds.minlat) || (node.lat > this->bounds.maxlat) ||
+		(node.lon < this->bounds.minlon) || (node.lon > this->bounds.maxlon))
+		return;
+
+	this->nodes.Insert(node.id, node.lat, node.lon);
+}
+
+// Ways (only highways are kept)
+void BatchInput::OnWay(const osm_way &way)
+{
+	highway road;
+	if (!this->rules->ParseHighway(way, road))
+		return;
+
+	this->highways.push_back(road);
+}
+
+// Constructor
+BatchRunner::BatchRunner(const network_options &options, const TagRules &rules, double tolerance, unsigned int threads): rules(rules)
+{
+	this->options = options;
+	this->tolerance = tolerance;
+	this->threads = threads;
+	this->reader_threads = 1;
+}
+
+// Run all the jobs of a manifest. Returns true if all of them worked.
+bool BatchRunner::Run(wxString manifest)
+{
+	if (!Load(manifest))
+		return false;
+
+	// A single input may use all the threads to be read
+	this->reader_threads = (this->inputs.size() == 1) ? this->threads : 1;
+
+	double start = ConversionStats::GetWallTime();
+	this->pool.reset(new ThreadPool(this->threads));
+
+	for (size_t i = 0; i < this->inputs.size(); i++)
+	{
+		shared_ptr<BatchInput> input = this->inputs[i];
+		this->pool->Submit([this, input]() { ReadInput(input); });
+	}
+
+	// The inputs are released by the last of their jobs
+	size_t count = this->inputs.size();
+	this->inputs.clear();
+	this->pool->Wait();
+	this->pool.reset();
+
+	double seconds = ConversionStats::GetWallTime() - start;
+
+	// Summary
+	size_t converted = 0;
+	unsigned long long paths = 0, bytes = 0;
+
+	for (size_t i = 0; i < this->jobs.size(); i++)
+	{
+		converted += this->jobs[i].ok ? 1 : 0;
+		paths += this->jobs[i].counters.paths;
+		bytes += this->jobs[i].counters.bytes_written;
+	}
+
+	wxPrintf(wxT("%lu of %lu jobs converted from %lu inputs in %.2f s.\n"), (unsigned long)converted,
+			 (unsigned long)this->jobs.size(), (unsigned long)count, seconds);
+
+	if (seconds > 0)
+		wxPrintf(wxT("Throughput: %.1f jobs/s, %.0f paths/s, %.1f MB/s read, %.1f MB/s written.\n"), this->jobs.size() / seconds,
+				 paths / seconds, this->bytes_read / seconds / 1e6, bytes / seconds / 1e6);
+
+	return converted == this->jobs.size();
+}
+
+// Read the manifest and group the jobs by input
+bool BatchRunner::Load(wxString manifest)
+{
+	wxFFile file(manifest, wxT("r"));
+	if (!file.IsOpened())
+	{
+		wxPrintf(wxT("The batch manifest %s could not be opened.\n"), manifest.c_str());
+		return false;
+	}
+
+	map<wxString, size_t> indices;
+	char line[4096];
+	unsigned int number = 0;
+
+	while (fgets(line, sizeof(line), file.fp()))
+	{
+		number++;
+		line[strcspn(line, "\r\n")] = 0;
+
+		// Split the fields
+		const char *separators = strchr(line, '\t') ? "\t" : " ";
+		string text = line;
+		vector<string> fields;
+		for (size_t field = text.find_first_not_of(separators); field != string::npos; )
+		{
+			size_t field_end = text.find_first_of(separators, field);
+			fields.push_back(text.substr(field, field_end - field));
+			field = text.find_first_not_of(separators, field_end);
+		}
+
+		if (fields.empty() || (fields[0][0] == '#'))
+			continue;
+
+		batch_job job;
+		long int *numbers[3] = { &job.width, &job.height, &job.speedlimit };
+		bool valid = (fields.size() >= 2) && (fields.size() <= 5);
+
+		for (size_t i = 0; i < 3; i++)
+		{
+			char *end = NULL;
+			*numbers[i] = (i + 2 < fields.size()) ? strtol(fields[i + 2].c_str(), &end, 10) : 0;
+			if ((end && *end) || (*numbers[i] < 0))
+				valid = false;
+		}
+
+		if (!valid)
+		{
+			wxPrintf(wxT("Line %u of the batch manifest must be: input output [width [height [speed]]]\n"), number);
+			return false;
+		}
+
+		job.input = wxString::FromUTF8(fields[0].c_str());
+		job.output = wxString::FromUTF8(fields[1].c_str());
+		job.ok = false;
+		job.seconds = 0;
+		memset(&job.counters, 0, sizeof(job.counters));
+		this->jobs.push_back(job);
+
+		// Jobs with the same input share it
+		if (indices.find(job.input) == indices.end())
+		{
+			indices[job.input] = this->inputs.size();
+			this->inputs.push_back(shared_ptr<BatchInput>(new BatchInput));
+			this->inputs.back()->name = job.input;
+			this->inputs.back()->rules = &this->rules;
+		}
+
+		this->inputs[indices[job.input]]->jobs.push_back(this->jobs.size() - 1);
+	}
+
+	if (this->jobs.empty())
+	{
+		wxPrintf(wxT("The batch manifest has no jobs.\n"));
+		return false;
+	}
+
+	return true;
+}
+
+// Read an input, then start its jobs
+void BatchRunner::ReadInput(shared_ptr<BatchInput> input)
+{
+	double start = ConversionStats::GetWallTime();
+	wxFFile file(input->name, wxT("rb"));
+	bool ok = file.IsOpened();
+
+	if (ok)
+	{
+		input->size = file.Length();
+		file.Close();
+	}
+
+	// Compressed inputs are decompressed while they are read
+	unique_ptr<InputStream> stream(ok ? InputStream::Open((const char *)input->name.fn_str(), this->reader_threads) : NULL);
+	ok = (stream.get() != NULL);
+
+	if (ok)
+	{
+		if (InputStream::HasExtension(InputStream::GetPlainName((const char *)input->name.fn_str()), ".pbf"))
+		{
+			PBFReader reader(input.get(), this->reader_threads);
+			ok = reader.Parse(*stream);
+		}
+		else
+		{
+			OSMReader reader(input.get(), this->reader_threads);
+			ok = reader.Parse(*stream);
+		}
+
+		stream.reset();
+	}
+
+	// Prepare what the jobs look up, so that it doesn't change while they run
+	input->nodes.Prepare();
+
+	if (ok && (this->tolerance > 0))
+	{
+		input->simplifier.reset(new Simplifier(this->tolerance));
+		for (size_t i = 0; i < input->highways.size(); i++)
+			input->simplifier->AddWay(input->highways[i].refs);
+
+		input->simplifier->Prepare();
+	}
+
+	double seconds = ConversionStats::GetWallTime() - start;
+
+	{
+		unique_lock<mutex> guard(this->lock);
+		this->bytes_read += input->size;
+	}
+
+	for (size_t i = 0; i < input->jobs.size(); i++)
+	{
+		batch_job &job = this->jobs[input->jobs[i]];
+		job.seconds = seconds / input->jobs.size();
+
+		if (!ok)
+		{
+			unique_lock<mutex> guard(this->lock);
+			this->finished++;
+			wxPrintf(wxT("[%lu/%lu] %s: the input could not be read.\n"), (unsigned long)this->finished,
+					 (unsigned long)this->jobs.size(), job.output.c_str());
+			continue;
+		}
+
+		this->pool->Submit([this, input, &job]() { RunJob(input, job); });
+	}
+}
+
+// Convert the highways of an input to the network of a job
+void BatchRunner::RunJob(shared_ptr<BatchInput> input, batch_job &job)
+{
+	double start = ConversionStats::GetWallTime();
+
+	NetworkBuilder builder;
+	builder.options = this->options;
+	builder.options.threads = 1;
+
+	// The job's settings replace the ones of the command line
+	if (job.width > 0)
+		builder.options.map_width = job.width;
+
+	if (job.height > 0)
+		builder.options.map_height = job.height;
+
+	if (job.speedlimit > 0)
+		builder.options.defaultspeed = job.speedlimit;
+
+	builder.nodes = &input->nodes;
+	builder.simplifier = input->simplifier.get();
+	builder.counters = &job.counters;
+
+	if (input->has_bounds)
+		builder.SetBounds(input->bounds);
+
+	bool ok = builder.Open((const char *)job.output.fn_str());
+	if (ok)
+	{
+		vector<Point> points;
+		for (size_t i = 0; i < input->highways.size(); i++)
+		{
+			builder.BuildHighway(input->highways[i], points);
+			builder.WriteHighway(input->highways[i], points);
+		}
+
+		ok = builder.Finish();
+	}
+
+	builder.Close(ok);
+	job.ok = ok;
+	job.seconds += ConversionStats::GetWallTime() - start;
+
+	unique_lock<mutex> guard(this->lock);
+	this->finished++;
+	wxPrintf(wxT("[%lu/%lu] %s: %s, %llu paths in %.2f s.\n"), (unsigned long)this->finished, (unsigned long)this->jobs.size(),
+			 job.output.c_str(), ok ? wxT("ok") : wxT("failed"), job.counters.paths, job.seconds);
+}
@@ -0,0 +1,69 @@
+/*
+ * MobSink network callback writer implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <CallbackWriter.h>
+
+using namespace std;
+
+// Constructor
+CallbackWriter::CallbackWriter(path_function on_path, begin_function on_begin)
+{
+	this->on_path = on_path;
+	this->on_begin = on_begin;
+	this->started = false;
+}
+
+// Start the network
+void CallbackWriter::Begin(long width, long height, long speedlimit)
+{
+	this->started = true;
+	if (this->on_begin)
+		this->on_begin(width, height, speedlimit);
+}
+
+// Give a path to the caller
+void CallbackWriter::Write(Path &path)
+{
+	this->on_path(path);
+}
+
+// Finish the network. There is nothing left to be written.
+bool CallbackWriter::End(void)
+{
+	return true;
+}
+
+// Return true if the network was started
+bool CallbackWriter::IsStarted(void)
+{
+	return this->started;
+}
+
+// Nothing is written to a file
+unsigned long long CallbackWriter::GetBytesWritten(void)
+{
+	return 0;
+}
+
+// Constructor
+PathListWriter::PathListWriter(vector<Path> &paths):
+	CallbackWriter([&paths](Path &path) { paths.push_back(path); },
+				   [this](long width, long height, long speedlimit) { this->width = width; this->height = height; this->speedlimit = speedlimit; })
+{
+	this->width = this->height = this->speedlimit = 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Conversion state.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ConversionState.h>
+#include <BinaryIO.h>
+#include <string.h>
+
+using namespace std;
+
+// Constructor
+ConversionState::ConversionState()
+{
+	this->minlat = this->maxlat = this->minlon = this->maxlon = 0;
+	this->width = this->height = this->speedlimit = 0;
+	this->tolerance = 0;
+	this->projection = 0;
+	this->rules = 0;
+}
+
+// Save the state with the nodes of an index
+bool ConversionState::Save(FILE *fp, NodeIndex &nodes)
+{
+	uint32_t version = CONVERSIONSTATE_VERSION, order = BINARYIO_BYTE_ORDER;
+	int64_t width = this->width, height = this->height, speedlimit = this->speedlimit;
+	int32_t projection = this->projection;
+
+	bool ok = (fwrite(CONVERSIONSTATE_MAGIC, 8, 1, fp) == 1) && BinaryPut(fp, version) && BinaryPut(fp, order) &&
+			BinaryPut(fp, this->minlat) && BinaryPut(fp, this->maxlat) && BinaryPut(fp, this->minlon) && BinaryPut(fp, this->maxlon) &&
+			BinaryPut(fp, width) && BinaryPut(fp, height) && BinaryPut(fp, speedlimit) && BinaryPut(fp, this->tolerance) &&
+			BinaryPut(fp, projection) && BinaryPut(fp, this->rules);
+
+	// Nodes, in id order
+	uint64_t count = nodes.GetSize();
+	ok = ok && BinaryPut(fp, count);
+	nodes.ForEach([&](int64_t id, const node_location &location)
+	{
+		ok = ok && BinaryPut(fp, id) && BinaryPut(fp, location.lat) && BinaryPut(fp, location.lon);
+	});
+
+	// Highways
+	count = this->ways.size();
+	ok = ok && BinaryPut(fp, count);
+
+	for (map<int64_t, state_way>::iterator it = this->ways.begin(); ok && (it != this->ways.end()); it++)
+	{
+		state_way &way = it->second;
+		int32_t flow = way.flow;
+		vector<float> points;
+
+		for (size_t i = 0; i < way.points.size(); i++)
+		{
+			points.push_back(way.points[i].GetX());
+			points.push_back(way.points[i].GetY());
+		}
+
+		ok = BinaryPut(fp, it->first) && BinaryPut(fp, flow) && BinaryPut(fp, way.speedlimit) && BinaryPutArray(fp, way.name.data(), way.name.size()) &&
+			BinaryPutArray(fp, way.refs.data(), way.refs.size()) && BinaryPutArray(fp, points.data(), points.size());
+	}
+
+	return ok && (fflush(fp) == 0);
+}
+
+// Load a saved state, inserting its nodes into an index
+bool ConversionState::Load(FILE *fp, NodeIndex &nodes)
+{
+	char magic[8];
+	uint32_t version, order;
+	int64_t width, height, speedlimit;
+	int32_t projection;
+
+	if ((fread(magic, 8, 1, fp) != 1) || (memcmp(magic, CONVERSIONSTATE_MAGIC, 8) != 0) || !BinaryGet(fp, version) || !BinaryGet(fp, order) ||
+		(version != CONVERSIONSTATE_VERSION) || (order != BINARYIO_BYTE_ORDER))
+		return false;
+
+	if (!BinaryGet(fp, this->minlat) || !BinaryGet(fp, this->maxlat) || !BinaryGet(fp, this->minlon) || !BinaryGet(fp, this->maxlon) ||
+		!BinaryGet(fp, width) || !BinaryGet(fp, height) || !BinaryGet(fp, speedlimit) || !BinaryGet(fp, this->tolerance) ||
+		!BinaryGet(fp, projection) || !BinaryGet(fp, this->rules))
+		return false;
+
+	this->width = width;
+	this->projection = projection;
+	this->height = height;
+	this->speedlimit = speedlimit;
+
+	// Nodes
+	uint64_t count;
+	if (!BinaryGet(fp, count))
+		return false;
+
+	for (uint64_t i = 0; i < count; i++)
+	{
+		int64_t id;
+		node_location location;
+		if (!BinaryGet(fp, id) || !BinaryGet(fp, location.lat) || !BinaryGet(fp, location.lon))
+			return false;
+
+		nodes.Insert(id, NodeIndex::ToDegrees(location.lat), NodeIndex::ToDegrees(location.lon));
+	}
+
+	// Highways
+	if (!BinaryGet(fp, count))
+		return false;
+
+	this->ways.clear();
+	for (uint64_t i = 0; i < count; i++)
+	{
+		int64_t id;
+		int32_t flow;
+		vector<char> name;
+		vector<float> points;
+
+		state_way way;
+		if (!BinaryGet(fp, id) || !BinaryGet(fp, flow) || !BinaryGet(fp, way.speedlimit) || !BinaryGetArray(fp, name) || !BinaryGetArray(fp, way.refs) ||
+			!BinaryGetArray(fp, points) || (points.size() % 2 != 0))
+			return false;
+
+		way.flow = flow;
+		way.name.assign(name.begin(), name.end());
+		for (size_t p = 0; p < points.size(); p += 2)
+			way.points.push_back(Point(points[p], points[p + 1]));
+
+		swap(this->ways[id], way);
+	}
+
+	return true;
+}
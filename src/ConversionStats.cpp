@@ -0,0 +1,198 @@
+/*
+ * Conversion statistics.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ConversionStats.h>
+#include <chrono>
+#include <string>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Phase names in the JSON output
+static const char *phase_names[STATS_PHASES] = { "references", "read", "simplify", "graph", "join", "finish" };
+
+// Allocation counters, if the operators that keep them are linked in
+stats_allocations *ConversionStats::allocation_counter = NULL;
+
+// Constructor
+ConversionStats::ConversionStats()
+{
+	memset(&this->counters, 0, sizeof(this->counters));
+	memset(this->phases, 0, sizeof(this->phases));
+}
+
+// Start timing a phase. A phase may be started more than once; the times add up.
+void ConversionStats::Start(stats_phase phase)
+{
+	this->phases[phase].run = true;
+	this->phases[phase].wall_start = GetWallTime();
+	this->phases[phase].cpu_start = clock();
+}
+
+// Stop timing a phase
+void ConversionStats::Stop(stats_phase phase)
+{
+	this->phases[phase].wall += GetWallTime() - this->phases[phase].wall_start;
+	this->phases[phase].cpu += (double)(clock() - this->phases[phase].cpu_start) / CLOCKS_PER_SEC;
+}
+
+// Write the statistics as JSON. Every member is always present, so the
+// phases that didn't run have "run": false and zero times.
+bool ConversionStats::Write(FILE *fp, const char *input, const char *output, bool ok)
+{
+	string in = Escape(input), out = Escape(output);
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"version\": %d,\n", CONVERSIONSTATS_VERSION);
+	fprintf(fp, "  \"input\": \"%s\",\n", in.c_str());
+	fprintf(fp, "  \"output\": \"%s\",\n", out.c_str());
+	fprintf(fp, "  \"ok\": %s,\n", ok ? "true" : "false");
+	fprintf(fp, "  \"phases\": {\n");
+
+	double wall = 0, cpu = 0;
+	for (int i = 0; i < STATS_PHASES; i++)
+	{
+		fprintf(fp, "    \"%s\": { \"run\": %s, \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f },\n",
+				phase_names[i], this->phases[i].run ? "true" : "false", this->phases[i].wall, this->phases[i].cpu);
+		wall += this->phases[i].wall;
+		cpu += this->phases[i].cpu;
+	}
+
+	fprintf(fp, "    \"total\": { \"run\": true, \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f }\n", wall, cpu);
+	fprintf(fp, "  },\n");
+	fprintf(fp, "  \"counters\": {\n");
+	fprintf(fp, "    \"nodes_read\": %llu,\n", this->counters.nodes_read);
+	fprintf(fp, "    \"nodes_outside\": %llu,\n", this->counters.nodes_outside);
+	fprintf(fp, "    \"ways_read\": %llu,\n", this->counters.ways_read);
+	fprintf(fp, "    \"highways\": %llu,\n", this->counters.highways);
+	fprintf(fp, "    \"refs_missing\": %llu,\n", this->counters.refs_missing);
+	fprintf(fp, "    \"paths\": %llu,\n", this->counters.paths);
+	fprintf(fp, "    \"crossings\": %llu,\n", this->counters.crossings);
+	fprintf(fp, "    \"bytes_written\": %llu\n", this->counters.bytes_written);
+	fprintf(fp, "  },\n");
+	fprintf(fp, "  \"memory\": {\n");
+	fprintf(fp, "    \"peak_rss_bytes\": %llu,\n", GetPeakMemory());
+	stats_allocations *counter = allocation_counter;
+	fprintf(fp, "    \"allocations_counted\": %s,\n", counter && counter->counting.load() ? "true" : "false");
+	fprintf(fp, "    \"allocations\": %llu,\n", counter ? counter->allocations.load() : 0ULL);
+	fprintf(fp, "    \"deallocations\": %llu\n", counter ? counter->deallocations.load() : 0ULL);
+	fprintf(fp, "  }\n");
+	fprintf(fp, "}\n");
+
+	return !ferror(fp);
+}
+
+// Return true if a phase was run
+bool ConversionStats::IsRun(stats_phase phase)
+{
+	return this->phases[phase].run;
+}
+
+// Wall clock time of a phase
+double ConversionStats::GetWallSeconds(stats_phase phase)
+{
+	return this->phases[phase].wall;
+}
+
+// Processor time of a phase (of all the threads)
+double ConversionStats::GetCPUSeconds(stats_phase phase)
+{
+	return this->phases[phase].cpu;
+}
+
+// Escape a text (like a file name) for a JSON string
+string ConversionStats::Escape(const char *text)
+{
+	string escaped;
+
+	for (; *text; text++)
+	{
+		if ((*text == '"') || (*text == '\\'))
+			escaped += '\\';
+
+		if ((unsigned char)*text < 0x20)
+		{
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", *text);
+			escaped += code;
+		}
+		else
+		{
+			escaped += *text;
+		}
+	}
+
+	return escaped;
+}
+
+// Name of a phase, as in the JSON output
+const char *ConversionStats::GetPhaseName(stats_phase phase)
+{
+	return phase_names[phase];
+}
+
+// Set the counters kept by the allocation operators. They call it as the
+// program starts.
+void ConversionStats::SetAllocationCounter(stats_allocations *counter)
+{
+	allocation_counter = counter;
+}
+
+// Count the allocations from now on. Returns false if the operators that
+// count them aren't linked in.
+bool ConversionStats::EnableAllocationCount(void)
+{
+	if (!allocation_counter)
+		return false;
+
+	allocation_counter->counting = true;
+	return true;
+}
+
+// Peak resident memory of the process in bytes (0 if unknown)
+unsigned long long ConversionStats::GetPeakMemory(void)
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS info;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info)))
+		return info.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+#ifdef __APPLE__
+		return usage.ru_maxrss;
+#else
+		return usage.ru_maxrss * 1024ULL;
+#endif
+#endif
+
+	return 0;
+}
+
+// Wall clock in seconds
+double ConversionStats::GetWallTime(void)
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,831 @@
+/*
+ * OpenStreetMap to MobSink conversion.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Converter.h>
+#include <Path.h>
+#include <Point.h>
+#include <MobSinkBinary.h>
+#include <MobSinkReader.h>
+#include <PBFReader.h>
+#include <math.h>
+#include <stdio.h>
+#include <memory>
+#include <string.h>
+
+using namespace std;
+
+// Move a temporary file over another one (which Windows doesn't do by itself)
+static bool ReplaceFile(const string &temporary, const string &name)
+{
+#ifdef _WIN32
+	remove(name.c_str());
+#endif
+	return rename(temporary.c_str(), name.c_str()) == 0;
+}
+
+// Run the conversion (or apply the changes) with the settings. The
+// statistics are written even if it fails.
+bool Converter::Run(void)
+{
+	this->builder.options = this->options;
+
+	bool ok = this->network_input ? ConvertNetwork(this->inputfile, this->outputfile) : Convert(this->inputfile, this->outputfile);
+	if (!this->statsfile.empty())
+		WriteStats(ok);
+
+	return ok;
+}
+
+// Convert an OpenStreetMap document in memory, giving the paths to the
+// writer. PBF data starts with the size of its first block header, whose
+// first byte is zero, and XML can't start with it.
+bool Converter::Run(const char *data, size_t size, NetworkWriter &writer)
+{
+	MemoryStream stream(data, size);
+	return Run(stream, (size > 0) && (data[0] == 0), writer);
+}
+
+// Convert an OpenStreetMap document read from a stream, giving the paths
+// to the writer. Two pass mode needs a stream that can seek.
+bool Converter::Run(istream &input, NetworkWriter &writer)
+{
+	StdStream stream(input);
+	return Run(stream, input.peek() == 0, writer);
+}
+
+// Convert an OpenStreetMap document that isn't in a file
+bool Converter::Run(InputStream &input, bool pbf, NetworkWriter &writer)
+{
+	if (this->network_input || !this->changesfile.empty() || !this->cachedir.empty() || (this->options.tile_rows > 0))
+	{
+		fprintf(this->messages, "Networks, changes, the cache and tiles need files.\n");
+		return false;
+	}
+
+	this->builder.options = this->options;
+	this->builder.nodes = &this->nodes;
+	this->builder.counters = &this->stats.counters;
+	this->builder.messages = this->messages;
+	this->pbf = pbf;
+
+	bool ok = this->builder.Open(&writer) && Convert(&input, NULL);
+	if (!this->statsfile.empty())
+		WriteStats(ok);
+
+	return ok;
+}
+
+// Convert a OpenStreetMap XML file to MobSink XML
+bool Converter::Convert(const string &input, const string &output)
+{
+	// Open the OSM file (or the state the changes are applied to).
+	// Compressed files are decompressed while they are read.
+	unique_ptr<InputStream> file;
+	FILE *statefp = NULL;
+	if (this->changesfile.empty())
+		file.reset(InputStream::Open(input, this->threads));
+	else
+		statefp = fopen(this->statefile.c_str(), "rb");
+
+	if (!file && !statefp)
+		return false;
+
+	// The paths are written to the output as soon as they are created
+	this->builder.nodes = &this->nodes;
+	this->builder.counters = &this->stats.counters;
+	this->builder.messages = this->messages;
+	this->pbf = InputStream::HasExtension(InputStream::GetPlainName(input), ".pbf");
+
+	bool ok = this->builder.Open(output) && Convert(file.get(), statefp);
+	if (statefp)
+		fclose(statefp);
+
+	return ok;
+}
+
+// Convert the input (or apply the changes to the state read from statefp)
+// to the output the builder has open
+bool Converter::Convert(InputStream *file, FILE *statefp)
+{
+	bool ok = true;
+
+	ConversionState state;
+	if (!this->statefile.empty())
+		this->state = &state;
+
+	// Only the changed highways are read again
+	if (!this->changesfile.empty())
+	{
+		ok = ApplyChanges(statefp);
+	}
+
+	Simplifier simplifier(this->tolerance);
+	if ((this->tolerance > 0) && this->changesfile.empty())
+		this->builder.simplifier = &simplifier;
+
+	// The highways go to the road graph instead of the output
+	RoadGraph graph;
+	if ((this->min_component > 0) || this->contract)
+		this->graph = &graph;
+
+	// In slim mode, the nodes and highways are kept in files next to the
+	// output until they are joined
+	string slimprefix = (this->outputfile.empty() ? string("osm2mobsink") : this->outputfile) + ".slim";
+	SlimStore slim(slimprefix, (size_t)this->memory_limit << 20);
+	if (ok && (this->memory_limit > 0))
+	{
+		ok = slim.Open();
+		this->slim = &slim;
+
+		if (!ok)
+			fprintf(this->messages, "The slim mode files could not be created at %s.\n", slimprefix.c_str());
+	}
+
+	// The cache is named after the input contents. If there is none yet,
+	// it is made from what is read now.
+	ParseCache cache;
+	string cachefile;
+	bool cached = false;
+
+	if (ok && !this->cachedir.empty())
+	{
+		this->stats.Start(STATS_READ);
+		FILE *raw = fopen(this->inputfile.c_str(), "rb");
+		ok = raw != NULL;
+		cache.key = ok ? ParseCache::Hash(raw) ^ this->rules.key : 0;
+		if (raw)
+			fclose(raw);
+
+		char name[32];
+		snprintf(name, sizeof(name), "/%016llx.cache", (unsigned long long)cache.key);
+		cachefile = this->cachedir + name;
+		cached = ok && ReadCache(cachefile, cache);
+		this->stats.Stop(STATS_READ);
+
+		if (!cached)
+			this->cache = &cache;
+	}
+
+	// In two pass mode, the first pass finds which nodes are used by
+	// highways, so that only those are kept in the second one. Like the
+	// second one, it only runs if everything before it worked.
+	if (ok && this->twopass && this->changesfile.empty() && !cached)
+	{
+		this->pass = READPASS_REFERENCES;
+		this->stats.Start(STATS_REFERENCES);
+		ok = ReadInput(*file) && file->Rewind();
+		this->stats.Stop(STATS_REFERENCES);
+		this->pass = READPASS_NODES;
+	}
+
+	// Read map data. The elements are handled as they are read, so only
+	// the nodes inside the boundaries are kept in memory.
+	if (ok && this->changesfile.empty() && !cached)
+	{
+		this->stats.Start(STATS_READ);
+		ok = ReadInput(*file);
+		this->stats.Stop(STATS_READ);
+	}
+
+	// Now that all the nodes are known, find the ones of the highways
+	if (ok && this->slim)
+	{
+		this->stats.Start(STATS_JOIN);
+		ok = slim.ForEach([this](highway &road, vector<node_location> &locations)
+		{
+			vector<Point> points;
+			this->builder.ProjectHighway(locations, points);
+			this->builder.WriteHighway(road, points);
+		}, this->stats.counters.refs_missing);
+		this->stats.Stop(STATS_JOIN);
+	}
+
+	// Simplify the ways that were waiting for the junctions to be known
+	if (ok && this->builder.simplifier)
+	{
+		this->stats.Start(STATS_SIMPLIFY);
+		this->builder.simplifier->Prepare();
+		for (unsigned int i = 0; i < this->highways.size(); i++)
+			InsertHighway(this->highways.at(i));
+
+		this->stats.Stop(STATS_SIMPLIFY);
+		fprintf(this->messages, "Simplification removed %lu of %lu segments.\n", this->builder.simplifier->GetRemoved(), this->builder.simplifier->GetSegments());
+	}
+
+	// Now that all the highways are known, the components and junctions are too
+	if (ok && this->graph)
+	{
+		this->stats.Start(STATS_GRAPH);
+		graph.Build();
+		size_t nodes = graph.GetNodeCount();
+		size_t segments = graph.GetEdgeCount();
+		size_t components = 0, pruned = 0, contracted = 0;
+
+		if (this->min_component > 0)
+			pruned = graph.Prune(this->min_component, components);
+
+		if (this->contract)
+			contracted = graph.Contract();
+
+		graph.Write(this->builder);
+		this->stats.Stop(STATS_GRAPH);
+
+		fprintf(this->messages, "Road graph: %lu nodes and %lu segments.\n", (unsigned long)nodes, (unsigned long)segments);
+		if (this->min_component > 0)
+			fprintf(this->messages, "Pruning removed %lu components with %lu nodes.\n", (unsigned long)components, (unsigned long)pruned);
+
+		if (this->contract)
+			fprintf(this->messages, "Contraction removed %lu segments.\n", (unsigned long)contracted);
+	}
+
+	// Keep what the next changes need
+	if (ok && this->state)
+		ok = SaveState();
+
+	// A cache that can't be saved just makes the next run slower
+	if (ok && this->cache && !SaveCache(cachefile))
+		fprintf(this->messages, "The cache could not be saved to %s.\n", cachefile.c_str());
+
+	this->highways.clear();
+	this->nodes.Clear();
+	this->referenced.Clear();
+	graph.Clear();
+	slim.Close();
+	this->builder.simplifier = NULL;
+	this->state = NULL;
+	this->cache = NULL;
+	this->graph = NULL;
+	this->slim = NULL;
+
+	// At this point, we have all the paths. Finish the network.
+	if (ok)
+	{
+		this->stats.Start(STATS_FINISH);
+		ok = this->builder.Finish();
+		this->stats.Stop(STATS_FINISH);
+	}
+
+	this->builder.Close(ok);
+	return ok;
+}
+
+// Convert a MobSink network (XML or binary) to the output format
+bool Converter::ConvertNetwork(const string &input, const string &output)
+{
+	MobSinkBinaryFile file;
+	MobSinkBinaryReader reader;
+	MobSinkReader xml;
+
+	// The file is mapped and a binary network is used in place. Anything
+	// else must be XML.
+	if (!file.Open(input.c_str()))
+		return false;
+
+	if ((file.GetSize() >= 8) && (memcmp(file.GetData(), MOBSINKBIN_MAGIC, 8) == 0))
+	{
+		if (!reader.Open(file.GetData(), file.GetSize()))
+			return false;
+	}
+	else if (!xml.Open((const char *)file.GetData(), file.GetSize()))
+	{
+		return false;
+	}
+
+	FILE *outputfile = fopen(output.c_str(), "wb");
+	if (!outputfile)
+		return false;
+
+	unique_ptr<NetworkWriter> writer(this->builder.CreateWriter(outputfile, this->builder.options.threads));
+	PathStore kept;
+
+	if (reader.IsOk())
+	{
+		const mobsinkbin_header *header = reader.GetHeader();
+		const mobsinkbin_path *paths = reader.GetPaths();
+		writer->Begin(header->width, header->height, header->speedlimit);
+
+		for (uint64_t i = 0; i < header->path_count; i++)
+		{
+			const mobsinkbin_path &p = paths[i];
+			Path path(p.xa, p.ya, p.xb, p.yb, (pathflow)p.flow);
+			path.SetName(wxString::FromUTF8(reader.GetName(p.name)));
+
+			// The table replaces the default controls of the new path
+			const mobsinkbin_control *controls = reader.GetControls(p);
+			path.GetPathControl()->clear();
+			for (uint32_t c = 0; c < p.control_count; c++)
+				path.InsertControl(controls[c].time, controls[c].speedlimit, controls[c].traffic, controls[c].blocked != 0);
+
+			WriteNetworkPath(*writer, kept, path);
+		}
+	}
+	else
+	{
+		writer->Begin(xml.width, xml.height, xml.speedlimit);
+
+		Path path;
+		while (xml.Next(path))
+			WriteNetworkPath(*writer, kept, path);
+	}
+
+	// The crossings are found once all the paths were read
+	if (this->builder.options.crossings != CROSSINGS_IGNORE)
+	{
+		this->builder.counters = &this->stats.counters;
+		this->builder.messages = this->messages;
+		this->builder.CheckCrossings(kept);
+
+		for (size_t i = 0; i < kept.GetSize(); i++)
+		{
+			Path path = kept.GetPath(i);
+			writer->Write(path);
+			this->stats.counters.paths++;
+		}
+	}
+
+	bool ok = writer->End() && (reader.IsOk() || xml.IsOk());
+	this->stats.counters.bytes_written = writer->GetBytesWritten();
+
+	writer.reset();
+	ok = (fclose(outputfile) == 0) && ok;
+	if (!ok)
+		remove(output.c_str());
+
+	return ok;
+}
+
+// Write a path of a network being converted. If crossings are looked for,
+// it is kept until all the paths were read.
+void Converter::WriteNetworkPath(NetworkWriter &writer, PathStore &paths, Path &path)
+{
+	if (this->builder.options.crossings != CROSSINGS_IGNORE)
+	{
+		paths.Add(path);
+		return;
+	}
+
+	writer.Write(path);
+	this->stats.counters.paths++;
+}
+
+// Read the input with the reader for its format
+bool Converter::ReadInput(InputStream &stream)
+{
+	if (this->pbf)
+	{
+		PBFReader reader(this, this->threads);
+		return reader.Parse(stream);
+	}
+
+	OSMReader reader(this, this->threads > 0 ? this->threads : 1);
+	return reader.Parse(stream);
+}
+
+// Read the input from its cache. The highways are handled as if they were
+// read from the input, so the network comes out the same.
+bool Converter::ReadCache(const string &cachefile, ParseCache &cache)
+{
+	FILE *fp = fopen(cachefile.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	bool ok = cache.Load(fp, this->nodes);
+	fclose(fp);
+
+	if (!ok)
+	{
+		this->nodes.Clear();
+		return false;
+	}
+
+	OnBounds(cache.bounds);
+
+	for (size_t i = 0; i < cache.ways.size(); i++)
+	{
+		cache_way &way = cache.ways[i];
+		highway road;
+		road.id = way.id;
+		road.refs.swap(way.refs);
+		road.name.swap(way.name);
+		road.flow = (pathflow)way.flow;
+		road.speedlimit = way.speedlimit;
+
+		this->stats.counters.highways++;
+		AddHighway(road);
+	}
+
+	vector<cache_way>().swap(cache.ways);
+	fprintf(this->messages, "Input read from the cache.\n");
+	return true;
+}
+
+// Save the cache of the input, through a temporary file
+bool Converter::SaveCache(const string &cachefile)
+{
+	string temporary = cachefile + ".tmp";
+	FILE *fp = fopen(temporary.c_str(), "wb");
+	if (!fp)
+		return false;
+
+	bool ok = this->cache->Save(fp, this->nodes);
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok || !ReplaceFile(temporary, cachefile))
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// Apply the OSM change file to the state read from a file. Only the paths
+// of the highways that changed, or that use a node that changed, are built
+// again. The network is then written with all the highways in id order.
+bool Converter::ApplyChanges(FILE *fp)
+{
+	ConversionState &state = *this->state;
+
+	// The network keeps the settings it was converted with
+	this->stats.Start(STATS_READ);
+	bool ok = state.Load(fp, this->nodes);
+	if (ok)
+	{
+		this->builder.minlat = state.minlat;
+		this->builder.maxlat = state.maxlat;
+		this->builder.minlon = state.minlon;
+		this->builder.maxlon = state.maxlon;
+		this->builder.options.map_width = state.width;
+		this->builder.options.map_height = state.height;
+		this->builder.options.defaultspeed = state.speedlimit;
+		this->builder.options.projection = (projectiontype)state.projection;
+		this->tolerance = state.tolerance;
+	}
+
+	// The changed highways must be read with the rules of the others
+	if (ok && (state.rules != this->rules.key))
+	{
+		fprintf(this->messages, "The state was saved with other tag rules, so the changes can't be applied with these.\n");
+		ok = false;
+	}
+
+	// The actions must be seen in order, so a single thread reads the changes
+	unique_ptr<InputStream> file(ok ? InputStream::Open(this->changesfile, this->threads) : NULL);
+	if (file)
+	{
+		this->pass = READPASS_CHANGES;
+		this->changes.action = OSM_CREATE;
+		OSMReader reader(this, 1);
+		ok = reader.Parse(*file);
+		this->pass = READPASS_SINGLE;
+	}
+	else
+	{
+		ok = false;
+	}
+
+	file.reset();
+	this->stats.Stop(STATS_READ);
+
+	if (!ok)
+		return false;
+
+	// Move the nodes. Nodes are removed after all the insertions, so that
+	// the index is sorted only once.
+	NodeSet touched;
+	vector<int64_t> removed(this->changes.deleted_nodes.begin(), this->changes.deleted_nodes.end());
+
+	for (map<int64_t, osm_node>::iterator it = this->changes.nodes.begin(); it != this->changes.nodes.end(); it++)
+	{
+		if (!this->builder.IsInside(it->second.lat, it->second.lon))
+		{
+			this->stats.counters.nodes_outside++;
+			removed.push_back(it->first);
+		}
+		else
+		{
+			nodes.Insert(it->first, it->second.lat, it->second.lon);
+		}
+
+		touched.Insert(it->first);
+	}
+
+	for (unsigned int i = 0; i < removed.size(); i++)
+	{
+		nodes.Remove(removed[i]);
+		touched.Insert(removed[i]);
+	}
+
+	// Replace the highways. When simplifying, the junctions of the old and
+	// new nodes of a highway may change, so the other highways using them
+	// must be simplified again as well.
+	set<int64_t> changed;
+
+	for (set<int64_t>::iterator it = this->changes.deleted_ways.begin(); it != this->changes.deleted_ways.end(); it++)
+	{
+		map<int64_t, state_way>::iterator way = state.ways.find(*it);
+		if (way == state.ways.end())
+			continue;
+
+		for (unsigned int i = 0; (this->tolerance > 0) && (i < way->second.refs.size()); i++)
+			touched.Insert(way->second.refs[i]);
+
+		state.ways.erase(way);
+	}
+
+	for (map<int64_t, highway>::iterator it = this->changes.ways.begin(); it != this->changes.ways.end(); it++)
+	{
+		state_way &way = state.ways[it->first];
+
+		for (unsigned int i = 0; (this->tolerance > 0) && (i < way.refs.size()); i++)
+			touched.Insert(way.refs[i]);
+
+		for (unsigned int i = 0; (this->tolerance > 0) && (i < it->second.refs.size()); i++)
+			touched.Insert(it->second.refs[i]);
+
+		way.refs = it->second.refs;
+		way.name = it->second.name;
+		way.flow = it->second.flow;
+		way.speedlimit = it->second.speedlimit;
+		changed.insert(it->first);
+	}
+
+	this->changes.nodes.clear();
+	this->changes.ways.clear();
+	this->changes.deleted_nodes.clear();
+	this->changes.deleted_ways.clear();
+
+	// The junctions depend on all the highways
+	Simplifier simplifier(this->tolerance);
+	if (this->tolerance > 0)
+	{
+		for (map<int64_t, state_way>::iterator it = state.ways.begin(); it != state.ways.end(); it++)
+			simplifier.AddWay(it->second.refs);
+
+		simplifier.Prepare();
+		this->builder.simplifier = &simplifier;
+	}
+
+	// Build the paths of the affected highways again
+	unsigned long updated = 0;
+	for (map<int64_t, state_way>::iterator it = state.ways.begin(); it != state.ways.end(); it++)
+	{
+		bool affected = changed.count(it->first) > 0;
+		for (unsigned int i = 0; !affected && (i < it->second.refs.size()); i++)
+			affected = touched.Contains(it->second.refs[i]);
+
+		if (!affected)
+			continue;
+
+		highway road;
+		road.id = it->first;
+		road.refs = it->second.refs;
+		this->builder.BuildHighway(road, it->second.points);
+		updated++;
+	}
+
+	this->builder.simplifier = NULL;
+
+	// Write the whole network
+	for (map<int64_t, state_way>::iterator it = state.ways.begin(); it != state.ways.end(); it++)
+	{
+		highway road;
+		road.id = it->first;
+		road.name = it->second.name;
+		road.flow = (pathflow)it->second.flow;
+		road.speedlimit = it->second.speedlimit;
+		this->builder.WriteHighway(road, it->second.points);
+	}
+
+	fprintf(this->messages, "%lu of %lu highways were updated.\n", updated, (unsigned long)state.ways.size());
+	return true;
+}
+
+// Save the conversion state. It is written to a temporary file first, so
+// that the old state is kept if anything goes wrong.
+bool Converter::SaveState(void)
+{
+	ConversionState &state = *this->state;
+	state.minlat = this->builder.minlat;
+	state.maxlat = this->builder.maxlat;
+	state.minlon = this->builder.minlon;
+	state.maxlon = this->builder.maxlon;
+	state.width = this->builder.options.map_width;
+	state.height = this->builder.options.map_height;
+	state.speedlimit = this->builder.options.defaultspeed;
+	state.projection = this->builder.options.projection;
+	state.tolerance = this->tolerance;
+	state.rules = this->rules.key;
+
+	string temporary = this->statefile + ".tmp";
+	FILE *fp = fopen(temporary.c_str(), "wb");
+	if (!fp)
+		return false;
+
+	bool ok = state.Save(fp, this->nodes);
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok || !ReplaceFile(temporary, this->statefile))
+	{
+		remove(temporary.c_str());
+		fprintf(this->messages, "The state could not be saved to %s.\n", this->statefile.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// Boundaries
+void Converter::OnBounds(const osm_bounds &bounds)
+{
+	// The boundaries of a change file don't resize the network
+	if ((this->pass == READPASS_REFERENCES) || (this->pass == READPASS_CHANGES))
+		return;
+
+	if (this->cache)
+		this->cache->bounds = bounds;
+
+	// After reading the boundaries of the map, it's time to determine the MobSink network size
+	this->builder.SetBounds(bounds);
+}
+
+// Nodes
+void Converter::OnNode(const osm_node &node)
+{
+	if (this->pass == READPASS_REFERENCES)
+		return;
+
+	this->stats.counters.nodes_read++;
+
+	// Change file: the last action on a node is the one that counts
+	if (this->pass == READPASS_CHANGES)
+	{
+		if (this->changes.action == OSM_DELETE)
+		{
+			this->changes.nodes.erase(node.id);
+			this->changes.deleted_nodes.insert(node.id);
+		}
+		else
+		{
+			this->changes.nodes[node.id] = node;
+			this->changes.deleted_nodes.erase(node.id);
+		}
+
+		return;
+	}
+
+	if ((this->pass == READPASS_NODES) && !referenced.Contains(node.id))
+		return;
+
+	// Discard this node if it is outside the boundaries of the exported map
+	if (!this->builder.IsInside(node.lat, node.lon))
+	{
+		this->stats.counters.nodes_outside++;
+		return;
+	}
+
+	// Only the location is kept. It is projected when a way uses it.
+	if (this->slim)
+		this->slim->AddNode(node.id, node.lat, node.lon);
+	else
+		nodes.Insert(node.id, node.lat, node.lon);
+}
+
+// Ways
+void Converter::OnWay(const osm_way &way)
+{
+	highway road;
+	bool insert_way = this->rules.ParseHighway(way, road);
+
+	// First pass: just remember the nodes of the highways
+	if (this->pass == READPASS_REFERENCES)
+	{
+		for (unsigned int i = 0; insert_way && (i < road.refs.size()); i++)
+			referenced.Insert(road.refs[i]);
+
+		return;
+	}
+
+	this->stats.counters.ways_read++;
+
+	// Change file: a way that is no longer a highway is removed as well
+	if (this->pass == READPASS_CHANGES)
+	{
+		if (!insert_way || (this->changes.action == OSM_DELETE))
+		{
+			this->changes.ways.erase(way.id);
+			this->changes.deleted_ways.insert(way.id);
+			return;
+		}
+
+		this->stats.counters.highways++;
+		this->changes.ways[way.id] = road;
+		this->changes.deleted_ways.erase(way.id);
+		return;
+	}
+
+	if (!insert_way)
+		return;
+
+	this->stats.counters.highways++;
+
+	// Its nodes are found once all of them were read
+	if (this->slim)
+	{
+		this->slim->AddHighway(road);
+		return;
+	}
+
+	// Remember the highway for the next runs
+	if (this->cache)
+	{
+		cache_way cached;
+		cached.id = road.id;
+		cached.refs = road.refs;
+		cached.name = road.name;
+		cached.flow = road.flow;
+		cached.speedlimit = road.speedlimit;
+		this->cache->ways.push_back(cached);
+	}
+
+	AddHighway(road);
+}
+
+// Change file actions
+void Converter::OnAction(osm_action action)
+{
+	this->changes.action = action;
+}
+
+// Convert a highway read from the input
+void Converter::AddHighway(highway &road)
+{
+	// The junctions are only known after all ways were read, so the ways
+	// to be simplified must wait until then
+	if (this->builder.simplifier)
+	{
+		this->builder.simplifier->AddWay(road.refs);
+		this->highways.push_back(road);
+		return;
+	}
+
+	InsertHighway(road);
+}
+
+// Create the paths of a highway and write them
+void Converter::InsertHighway(highway &road)
+{
+	vector<Point> points;
+
+	// The graph keeps the nodes, so that the junctions can be found
+	if (this->graph)
+	{
+		vector<int64_t> ids;
+		this->builder.BuildHighway(road, ids, points);
+		this->graph->AddHighway(road, ids, points);
+		return;
+	}
+
+	this->builder.BuildHighway(road, points);
+
+	// Keep the points for the changes to come
+	if (this->state)
+	{
+		state_way &way = this->state->ways[road.id];
+		way.refs = road.refs;
+		way.name = road.name;
+		way.flow = road.flow;
+		way.speedlimit = road.speedlimit;
+		way.points = points;
+	}
+
+	this->builder.WriteHighway(road, points);
+}
+
+// Save the conversion statistics
+void Converter::WriteStats(bool ok)
+{
+	FILE *fp = fopen(this->statsfile.c_str(), "w");
+	const string &input = this->changesfile.empty() ? this->inputfile : this->changesfile;
+	bool written = fp && this->stats.Write(fp, input.c_str(), this->outputfile.c_str(), ok);
+	if (fp)
+		written = (fclose(fp) == 0) && written;
+
+	if (!written)
+		fprintf(this->messages, "The statistics could not be written to %s.\n", this->statsfile.c_str());
+}
@@ -0,0 +1,666 @@
+/*
+ * Input streams.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <InputStream.h>
+#include <ThreadPool.h>
+#include <bzlib.h>
+#include <zlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Markers of the bzip2 format (48 bits each)
+#define BZIP2_BLOCK_MAGIC 0x314159265359ULL
+#define BZIP2_END_MAGIC 0x177245385090ULL
+#define BZIP2_MAGIC_MASK 0xffffffffffffULL
+
+// Open a file for reading, decompressing it if its name ends in .gz or .bz2
+InputStream *InputStream::Open(const string &name, unsigned int threads)
+{
+	FILE *fp = fopen(name.c_str(), "rb");
+	if (!fp)
+		return NULL;
+
+	if (HasExtension(name, ".gz"))
+		return new GzipStream(fp);
+
+	if (HasExtension(name, ".bz2"))
+		return new Bzip2Stream(fp, threads > 0 ? threads : ThreadPool::GetDefaultSize());
+
+	return new FileStream(fp, true);
+}
+
+// Return the name of a file without the compression extension
+string InputStream::GetPlainName(const string &name)
+{
+	if (HasExtension(name, ".gz") || HasExtension(name, ".bz2"))
+		return name.substr(0, name.rfind('.'));
+
+	return name;
+}
+
+// Check if a file name ends in the given extension, ignoring the case
+bool InputStream::HasExtension(const string &name, const char *extension)
+{
+	size_t length = strlen(extension);
+	if (name.size() < length)
+		return false;
+
+	for (size_t i = 0, start = name.size() - length; i < length; i++)
+		if (tolower((unsigned char)name[start + i]) != tolower((unsigned char)extension[i]))
+			return false;
+
+	return true;
+}
+
+// Constructor
+FileStream::FileStream(FILE *fp, bool owner)
+{
+	this->fp = fp;
+	this->owner = owner;
+}
+
+// Destructor
+FileStream::~FileStream()
+{
+	if (this->owner)
+		fclose(this->fp);
+}
+
+// Read data
+size_t FileStream::Read(void *data, size_t size)
+{
+	return fread(data, 1, size, this->fp);
+}
+
+// Return true at the end of the file
+bool FileStream::IsEnd(void)
+{
+	return feof(this->fp) || ferror(this->fp);
+}
+
+// Return true if the file could not be read
+bool FileStream::IsError(void)
+{
+	return ferror(this->fp);
+}
+
+// Go back to the start of the file
+bool FileStream::Rewind(void)
+{
+	return fseek(this->fp, 0, SEEK_SET) == 0;
+}
+
+// Constructor
+MemoryStream::MemoryStream(const void *data, size_t size)
+{
+	this->data = (const char *)data;
+	this->size = size;
+	this->offset = 0;
+}
+
+// Read data
+size_t MemoryStream::Read(void *data, size_t size)
+{
+	size_t n = min(size, this->size - this->offset);
+	memcpy(data, this->data + this->offset, n);
+	this->offset += n;
+	return n;
+}
+
+// Return true at the end of the data
+bool MemoryStream::IsEnd(void)
+{
+	return this->offset == this->size;
+}
+
+// Memory can always be read
+bool MemoryStream::IsError(void)
+{
+	return false;
+}
+
+// Go back to the start of the data
+bool MemoryStream::Rewind(void)
+{
+	this->offset = 0;
+	return true;
+}
+
+// Constructor
+StdStream::StdStream(istream &stream): stream(stream)
+{
+	this->start = stream.tellg();
+}
+
+// Read data
+size_t StdStream::Read(void *data, size_t size)
+{
+	this->stream.read((char *)data, size);
+	return this->stream.gcount();
+}
+
+// Return true at the end of the stream
+bool StdStream::IsEnd(void)
+{
+	return !this->stream.good();
+}
+
+// Return true if the stream could not be read
+bool StdStream::IsError(void)
+{
+	return this->stream.bad();
+}
+
+// Go back to where the stream started
+bool StdStream::Rewind(void)
+{
+	if (this->start == streampos(-1))
+		return false;
+
+	this->stream.clear();
+	this->stream.seekg(this->start);
+	return !this->stream.fail();
+}
+
+// Constructor. The subclasses start the background thread.
+DecompressStream::DecompressStream(FILE *fp)
+{
+	this->fp = fp;
+	this->offset = 0;
+	this->finished = false;
+	this->error = false;
+	this->stop = false;
+}
+
+// Destructor. The subclasses stop the background thread.
+DecompressStream::~DecompressStream()
+{
+	fclose(this->fp);
+}
+
+// Read decompressed data, waiting for it if needed
+size_t DecompressStream::Read(void *data, size_t size)
+{
+	unique_lock<mutex> guard(this->lock);
+	size_t total = 0;
+
+	while (total < size)
+	{
+		while (this->blocks.empty() && !this->finished)
+			this->changed.wait(guard);
+
+		if (this->blocks.empty())
+			break;
+
+		string &block = this->blocks.front();
+		size_t n = min(size - total, block.size() - this->offset);
+		memcpy((char *)data + total, block.data() + this->offset, n);
+		total += n;
+		this->offset += n;
+
+		if (this->offset == block.size())
+		{
+			this->blocks.pop_front();
+			this->offset = 0;
+			this->changed.notify_all();
+		}
+	}
+
+	return total;
+}
+
+// Return true when all the data was read
+bool DecompressStream::IsEnd(void)
+{
+	unique_lock<mutex> guard(this->lock);
+	return this->finished && this->blocks.empty();
+}
+
+// Return true if the file could not be read or decompressed
+bool DecompressStream::IsError(void)
+{
+	unique_lock<mutex> guard(this->lock);
+	return this->error;
+}
+
+// Decompress the file again from the start
+bool DecompressStream::Rewind(void)
+{
+	Stop();
+	if (fseek(this->fp, 0, SEEK_SET) != 0)
+		return false;
+
+	Start();
+	return true;
+}
+
+// Start the background thread
+void DecompressStream::Start(void)
+{
+	this->blocks.clear();
+	this->offset = 0;
+	this->finished = false;
+	this->error = false;
+	this->stop = false;
+	this->worker = thread(&DecompressStream::Run, this);
+}
+
+// Stop the background thread, dropping what was not read
+void DecompressStream::Stop(void)
+{
+	{
+		unique_lock<mutex> guard(this->lock);
+		this->stop = true;
+	}
+
+	this->changed.notify_all();
+	if (this->worker.joinable())
+		this->worker.join();
+}
+
+// Queue decompressed data, waiting while the queue is full. Returns false
+// if the stream is being stopped.
+bool DecompressStream::Put(const char *data, size_t size)
+{
+	if (size == 0)
+		return !this->stop;
+
+	unique_lock<mutex> guard(this->lock);
+	while (!this->stop && (this->blocks.size() >= INPUTSTREAM_QUEUE_SIZE))
+		this->changed.wait(guard);
+
+	if (this->stop)
+		return false;
+
+	this->blocks.push_back(string(data, size));
+	this->changed.notify_all();
+	return true;
+}
+
+// Return true if the stream is being stopped
+bool DecompressStream::IsStopping(void)
+{
+	return this->stop;
+}
+
+// Background thread
+void DecompressStream::Run(void)
+{
+	bool ok = Decompress() && !ferror(this->fp);
+
+	unique_lock<mutex> guard(this->lock);
+	this->finished = true;
+	this->error = !ok && !this->stop;
+	this->changed.notify_all();
+}
+
+// Constructor
+GzipStream::GzipStream(FILE *fp): DecompressStream(fp)
+{
+	Start();
+}
+
+// Destructor
+GzipStream::~GzipStream()
+{
+	Stop();
+}
+
+// Inflate the members of the file one after the other
+bool GzipStream::Decompress(void)
+{
+	vector<char> input(INPUTSTREAM_BLOCK_SIZE), output(INPUTSTREAM_BLOCK_SIZE);
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+
+	// 16 + MAX_WBITS: gzip header and trailer
+	if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+		return false;
+
+	bool ok = true, member = false;
+	while (ok)
+	{
+		if (stream.avail_in == 0)
+		{
+			stream.avail_in = fread(&input[0], 1, input.size(), this->fp);
+			stream.next_in = (Bytef *)&input[0];
+
+			if (stream.avail_in == 0)
+				break;
+		}
+
+		stream.next_out = (Bytef *)&output[0];
+		stream.avail_out = output.size();
+		int result = inflate(&stream, Z_NO_FLUSH);
+		member = true;
+
+		if ((result != Z_OK) && (result != Z_STREAM_END) && (result != Z_BUF_ERROR))
+			ok = false;
+		else if (!Put(&output[0], output.size() - stream.avail_out))
+			ok = false;
+
+		// Another member may follow
+		if (ok && (result == Z_STREAM_END))
+		{
+			inflateReset(&stream);
+			member = false;
+		}
+	}
+
+	inflateEnd(&stream);
+
+	// A member cut short is an error
+	return ok && !member;
+}
+
+// Constructor
+Bzip2Stream::Bzip2Stream(FILE *fp, unsigned int threads): DecompressStream(fp)
+{
+	this->threads = threads;
+	Start();
+}
+
+// Destructor
+Bzip2Stream::~Bzip2Stream()
+{
+	Stop();
+}
+
+// Decompress the file
+bool Bzip2Stream::Decompress(void)
+{
+	return (this->threads > 1) ? DecompressParallel() : DecompressSerial();
+}
+
+// Decompress the streams of the file one after the other
+bool Bzip2Stream::DecompressSerial(void)
+{
+	vector<char> input(INPUTSTREAM_BLOCK_SIZE), output(INPUTSTREAM_BLOCK_SIZE);
+	bz_stream stream;
+	memset(&stream, 0, sizeof(stream));
+
+	if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK)
+		return false;
+
+	bool ok = true, open = false;
+	while (ok)
+	{
+		if (stream.avail_in == 0)
+		{
+			stream.avail_in = fread(&input[0], 1, input.size(), this->fp);
+			stream.next_in = &input[0];
+
+			if (stream.avail_in == 0)
+				break;
+		}
+
+		stream.next_out = &output[0];
+		stream.avail_out = output.size();
+		int result = BZ2_bzDecompress(&stream);
+		open = true;
+
+		if ((result != BZ_OK) && (result != BZ_STREAM_END))
+			ok = false;
+		else if (!Put(&output[0], output.size() - stream.avail_out))
+			ok = false;
+
+		// Another stream may follow
+		if (ok && (result == BZ_STREAM_END))
+		{
+			BZ2_bzDecompressEnd(&stream);
+			unsigned int left = stream.avail_in;
+			char *next = stream.next_in;
+			memset(&stream, 0, sizeof(stream));
+			stream.avail_in = left;
+			stream.next_in = next;
+			ok = (BZ2_bzDecompressInit(&stream, 0, 0) == BZ_OK);
+			open = false;
+		}
+	}
+
+	BZ2_bzDecompressEnd(&stream);
+	return ok && !open;
+}
+
+// A bzip2 block, with its bits copied from the file. The block starts at
+// bit 'shift' of the first byte and has 'bits' bits.
+struct bzip2_block
+{
+	vector<uint8_t> bytes;
+	unsigned int shift;
+	uint64_t bits;
+};
+
+// Writes a sequence of bits
+class BitWriter
+{
+public:
+	BitWriter(string &out): out(out), buffer(0), count(0) {}
+
+	void Put(uint64_t value, unsigned int bits)
+	{
+		for (unsigned int i = bits; i > 0; )
+		{
+			unsigned int n = min(i, 8u);
+			i -= n;
+			this->buffer = (this->buffer << n) | ((value >> i) & ((1u << n) - 1));
+			this->count += n;
+
+			if (this->count >= 8)
+			{
+				this->count -= 8;
+				this->out.push_back((char)(this->buffer >> this->count));
+			}
+		}
+	}
+
+	// Pad the last byte with zeros
+	void Flush(void)
+	{
+		if (this->count > 0)
+			Put(0, 8 - this->count);
+	}
+
+private:
+	string &out;
+	uint32_t buffer;
+	unsigned int count;
+};
+
+// Read bits of a block
+static uint64_t GetBits(const bzip2_block &block, uint64_t position, unsigned int bits)
+{
+	uint64_t value = 0;
+	for (unsigned int i = 0; i < bits; i++)
+	{
+		uint64_t bit = block.shift + position + i;
+		value = (value << 1) | ((block.bytes[bit / 8] >> (7 - bit % 8)) & 1);
+	}
+
+	return value;
+}
+
+// Decompress a block on its own. It is put in a stream of its own, whose
+// CRC is the CRC of the block.
+static bool DecompressBlock(const bzip2_block &block, string &output)
+{
+	string stream("BZh9");
+	BitWriter writer(stream);
+
+	uint64_t full = block.bits / 8;
+	for (uint64_t i = 0; i < full; i++)
+	{
+		unsigned int byte = block.bytes[i] << block.shift;
+		if (block.shift > 0)
+			byte |= block.bytes[i + 1] >> (8 - block.shift);
+
+		writer.Put(byte & 0xff, 8);
+	}
+
+	writer.Put(GetBits(block, full * 8, block.bits % 8), block.bits % 8);
+	writer.Put(BZIP2_END_MAGIC, 48);
+	writer.Put(GetBits(block, 48, 32), 32);
+	writer.Flush();
+
+	bz_stream bz;
+	memset(&bz, 0, sizeof(bz));
+	if (BZ2_bzDecompressInit(&bz, 0, 0) != BZ_OK)
+		return false;
+
+	bz.next_in = &stream[0];
+	bz.avail_in = stream.size();
+	output.clear();
+
+	int result = BZ_OK;
+	while (result == BZ_OK)
+	{
+		size_t used = output.size();
+		output.resize(used + INPUTSTREAM_BLOCK_SIZE);
+		bz.next_out = &output[used];
+		bz.avail_out = INPUTSTREAM_BLOCK_SIZE;
+		result = BZ2_bzDecompress(&bz);
+		output.resize(output.size() - bz.avail_out);
+
+		// No progress means the block was cut short
+		if ((result == BZ_OK) && (bz.avail_in == 0) && (bz.avail_out > 0))
+			result = BZ_UNEXPECTED_EOF;
+	}
+
+	BZ2_bzDecompressEnd(&bz);
+	return result == BZ_STREAM_END;
+}
+
+// Join two blocks that follow each other
+static bzip2_block JoinBlocks(const bzip2_block &a, const bzip2_block &b)
+{
+	bzip2_block joined;
+	size_t keep = (a.shift + a.bits) / 8;
+	joined.bytes.assign(a.bytes.begin(), a.bytes.begin() + keep);
+	joined.bytes.insert(joined.bytes.end(), b.bytes.begin(), b.bytes.end());
+	joined.shift = a.shift;
+	joined.bits = a.bits + b.bits;
+	return joined;
+}
+
+// Find the blocks of the file and decompress them in parallel, in the
+// order they appear. Blocks start with a 48-bit marker at any bit of the
+// file, and the same bits may show up inside compressed data. A block
+// split at such a place fails to decompress, and is then tried again
+// joined with the next one.
+bool Bzip2Stream::DecompressParallel(void)
+{
+	typedef pair<shared_ptr<bzip2_block>, future<shared_ptr<string> > > pending_block;
+
+	ThreadPool pool(this->threads);
+	deque<pending_block> pending;
+	size_t window = pool.GetSize() * 2;
+	vector<uint8_t> data;
+	uint64_t scan = 0;                      // Next bit to look for markers
+	uint64_t start = UINT64_MAX;            // First bit of the current block
+	bool ok = true, last = false, found = false;
+
+	// Decompress a block, giving an empty pointer on errors
+	auto submit = [&](shared_ptr<bzip2_block> block)
+	{
+		pending.push_back(make_pair(block, pool.Async<shared_ptr<string> >([block]()
+		{
+			shared_ptr<string> output(new string);
+			return DecompressBlock(*block, *output) ? output : shared_ptr<string>();
+		})));
+	};
+
+	// Hand the oldest block to the reader
+	auto next = [&]()
+	{
+		shared_ptr<string> output = pending.front().second.get();
+		if (!output && (pending.size() > 1))
+		{
+			bzip2_block joined = JoinBlocks(*pending[0].first, *pending[1].first);
+			pending[1].second.wait();
+			pending.pop_front();
+
+			output.reset(new string);
+			if (!DecompressBlock(joined, *output))
+				output.reset();
+		}
+
+		pending.pop_front();
+		return output && Put(output->data(), output->size());
+	};
+
+	while (ok && !last && !IsStopping())
+	{
+		size_t used = data.size();
+		data.resize(used + INPUTSTREAM_BLOCK_SIZE);
+		data.resize(used + fread(&data[used], 1, INPUTSTREAM_BLOCK_SIZE, this->fp));
+		last = feof(this->fp) || ferror(this->fp);
+
+		// Look for the markers in every bit position (a marker must fit whole)
+		for (size_t i = scan / 8; ok && (i + 8 <= data.size()); i++)
+		{
+			uint64_t word = 0;
+			for (int j = 0; j < 8; j++)
+				word = (word << 8) | data[i + j];
+
+			for (unsigned int shift = 0; shift < 8; shift++)
+			{
+				uint64_t bit = (uint64_t)i * 8 + shift;
+				uint64_t marker = (word >> (16 - shift)) & BZIP2_MAGIC_MASK;
+				if ((bit < scan) || ((marker != BZIP2_BLOCK_MAGIC) && (marker != BZIP2_END_MAGIC)))
+					continue;
+
+				// The bits up to here are a block
+				if (start != UINT64_MAX)
+				{
+					shared_ptr<bzip2_block> block(new bzip2_block);
+					block->shift = start % 8;
+					block->bits = bit - start;
+					block->bytes.assign(data.begin() + start / 8, data.begin() + (bit + 7) / 8 + 1);
+					submit(block);
+
+					while (ok && (pending.size() > window))
+						ok = next();
+				}
+
+				start = (marker == BZIP2_BLOCK_MAGIC) ? bit : UINT64_MAX;
+				found = true;
+				scan = bit + 48;
+			}
+		}
+
+		if (data.size() >= 8)
+			scan = max(scan, (uint64_t)(data.size() - 7) * 8);
+
+		// Drop the bytes before the current block
+		size_t drop = (start != UINT64_MAX ? start : scan) / 8;
+		data.erase(data.begin(), data.begin() + drop);
+		scan -= drop * 8;
+		if (start != UINT64_MAX)
+			start -= drop * 8;
+	}
+
+	while (ok && !pending.empty())
+		ok = next();
+
+	// The last block must be closed by the end of stream marker
+	return ok && found && (start == UINT64_MAX) && !IsStopping();
+}
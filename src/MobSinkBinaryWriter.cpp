@@ -0,0 +1,209 @@
+/*
+ * MobSink binary network writer.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <MobSinkBinaryWriter.h>
+#include <string.h>
+
+using namespace std;
+
+// Constructor
+MobSinkBinaryWriter::MobSinkBinaryWriter(FILE *fp)
+{
+	this->fp = fp;
+	this->buffer.reserve(MOBSINKBINARYWRITER_BUFFER_SIZE);
+	this->written = 0;
+	this->started = false;
+	this->ok = true;
+
+	memset(&this->header, 0, sizeof(this->header));
+	memcpy(this->header.magic, MOBSINKBIN_MAGIC, 8);
+	this->header.version = MOBSINKBIN_VERSION;
+	this->header.header_size = sizeof(mobsinkbin_header);
+
+	// Name 0 is the empty name
+	this->name_ids[string()] = 0;
+	this->names.push_back(0);
+	this->strings.push_back(0);
+}
+
+// Reserve the header. It is written when the sizes are known.
+void MobSinkBinaryWriter::Begin(long width, long height, long speedlimit)
+{
+	this->header.width = width;
+	this->header.height = height;
+	this->header.speedlimit = speedlimit;
+	this->header.path_offset = sizeof(mobsinkbin_header);
+
+	this->buffer.resize(sizeof(mobsinkbin_header));
+	this->started = true;
+}
+
+// Write a path
+void MobSinkBinaryWriter::Write(Path &path)
+{
+	// Intern its name
+	string name(path.GetName().utf8_str());
+	unordered_map<string, uint32_t>::iterator it = this->name_ids.find(name);
+	if (it == this->name_ids.end())
+	{
+		it = this->name_ids.insert(make_pair(name, (uint32_t)this->names.size())).first;
+		this->names.push_back(this->strings.size());
+		this->strings.append(name.c_str(), name.size() + 1);
+	}
+
+	// Keep its controls (the map is sorted by time)
+	map<int, struct path_control_params> *params = path.GetPathControl();
+	uint32_t first = this->controls.size();
+
+	for (map<int, struct path_control_params>::iterator c = params->begin(); c != params->end(); c++)
+	{
+		mobsinkbin_control control;
+		control.time = c->first;
+		control.speedlimit = c->second.speedlimit;
+		control.traffic = c->second.traffic;
+		control.blocked = c->second.blocked;
+		this->controls.push_back(control);
+	}
+
+	PutFloat(path.GetPointA().GetX());
+	PutFloat(path.GetPointA().GetY());
+	PutFloat(path.GetPointB().GetX());
+	PutFloat(path.GetPointB().GetY());
+	Put32(it->second);
+	Put32(path.GetFlow());
+	Put32(first);
+	Put32(this->controls.size() - first);
+
+	this->header.path_count++;
+	if (this->buffer.size() >= MOBSINKBINARYWRITER_BUFFER_SIZE)
+		Flush();
+}
+
+// Append the tables and write the header
+bool MobSinkBinaryWriter::End(void)
+{
+	if (!this->started)
+		Begin(0, 0, 0);
+
+	// Controls
+	Pad();
+	this->header.control_offset = GetBytesWritten();
+	this->header.control_count = this->controls.size();
+
+	for (size_t i = 0; i < this->controls.size(); i++)
+	{
+		Put32(this->controls[i].time);
+		PutFloat(this->controls[i].speedlimit);
+		PutFloat(this->controls[i].traffic);
+		Put32(this->controls[i].blocked);
+
+		if (this->buffer.size() >= MOBSINKBINARYWRITER_BUFFER_SIZE)
+			Flush();
+	}
+
+	// Names
+	Pad();
+	this->header.name_offset = GetBytesWritten();
+	this->header.name_count = this->names.size();
+	this->names.push_back(this->strings.size());
+
+	for (size_t i = 0; i < this->names.size(); i++)
+		Put64(this->names[i]);
+
+	this->header.string_offset = GetBytesWritten();
+	this->header.string_size = this->strings.size();
+	this->buffer.insert(this->buffer.end(), this->strings.begin(), this->strings.end());
+	Pad();
+	Flush();
+
+	// Header
+	this->buffer.clear();
+	this->buffer.insert(this->buffer.end(), this->header.magic, this->header.magic + 8);
+	Put32(this->header.version);
+	Put32(this->header.header_size);
+	Put64(this->header.width);
+	Put64(this->header.height);
+	Put64(this->header.speedlimit);
+	Put64(this->header.path_count);
+	Put64(this->header.path_offset);
+	Put64(this->header.control_count);
+	Put64(this->header.control_offset);
+	Put64(this->header.name_count);
+	Put64(this->header.name_offset);
+	Put64(this->header.string_size);
+	Put64(this->header.string_offset);
+	this->buffer.resize(sizeof(mobsinkbin_header), 0);
+
+	unsigned long long size = this->written;
+	if ((fseek(this->fp, 0, SEEK_SET) != 0) || (fwrite(&this->buffer[0], 1, this->buffer.size(), this->fp) != this->buffer.size()) ||
+		(fseek(this->fp, 0, SEEK_END) != 0) || (fflush(this->fp) != 0))
+		this->ok = false;
+
+	this->buffer.clear();
+	this->written = size;
+	return this->ok;
+}
+
+// Return true if Begin() was called
+bool MobSinkBinaryWriter::IsStarted(void)
+{
+	return this->started;
+}
+
+// Return the number of bytes written so far
+unsigned long long MobSinkBinaryWriter::GetBytesWritten(void)
+{
+	return this->written + this->buffer.size();
+}
+
+// Append little-endian values to the buffer
+void MobSinkBinaryWriter::Put32(uint32_t value)
+{
+	unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+	this->buffer.insert(this->buffer.end(), bytes, bytes + 4);
+}
+
+void MobSinkBinaryWriter::Put64(uint64_t value)
+{
+	Put32(value);
+	Put32(value >> 32);
+}
+
+void MobSinkBinaryWriter::PutFloat(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, 4);
+	Put32(bits);
+}
+
+// Align the next section to 8 bytes
+void MobSinkBinaryWriter::Pad(void)
+{
+	while (GetBytesWritten() % 8 != 0)
+		this->buffer.push_back(0);
+}
+
+// Write the buffer to the file
+void MobSinkBinaryWriter::Flush(void)
+{
+	if (!this->buffer.empty() && (fwrite(&this->buffer[0], 1, this->buffer.size(), this->fp) != this->buffer.size()))
+		this->ok = false;
+
+	this->written += this->buffer.size();
+	this->buffer.clear();
+}
@@ -0,0 +1,295 @@
+/*
+ * MobSink XML network reader.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <MobSinkReader.h>
+#include <OSMReader.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+// XML white space
+static inline bool IsSpace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+// Constructor
+MobSinkReader::MobSinkReader()
+{
+	this->data = NULL;
+	this->size = 0;
+	this->position = 0;
+	this->ok = false;
+	this->done = true;
+	this->closing = false;
+	this->empty = false;
+	this->nattrs = 0;
+	this->width = this->height = this->speedlimit = 0;
+}
+
+// Start reading a network. Its root must be the first element.
+bool MobSinkReader::Open(const char *data, size_t size)
+{
+	this->data = data;
+	this->size = size;
+	this->position = 0;
+	this->ok = true;
+	this->done = false;
+	this->stack.clear();
+
+	if (!NextElement() || this->closing || (this->element != "network"))
+	{
+		this->ok = false;
+		return false;
+	}
+
+	this->width = atol(GetAttribute("width").c_str());
+	this->height = atol(GetAttribute("height").c_str());
+	this->speedlimit = atol(GetAttribute("speedlimit").c_str());
+
+	if (this->empty)
+		this->done = true;
+	else
+		this->stack.push_back(this->element);
+
+	return true;
+}
+
+// Read the next path. Returns false at the end of the network or on errors.
+bool MobSinkReader::Next(Path &path)
+{
+	bool in_path = false;
+
+	while (this->ok && !this->done && NextElement())
+	{
+		if (this->closing)
+		{
+			if (this->stack.empty() || (this->stack.back() != this->element))
+				break;
+
+			this->stack.pop_back();
+			if (this->stack.empty())
+				this->done = true;
+			else if (in_path && (this->stack.size() == 1))
+				return true;
+
+			continue;
+		}
+
+		size_t depth = this->stack.size();
+		if (!this->empty)
+			this->stack.push_back(this->element);
+
+		// The paths are children of the root, and their controls are theirs
+		if ((depth == 1) && (this->element == "path"))
+		{
+			path = Path(atof(GetAttribute("xa").c_str()), atof(GetAttribute("ya").c_str()),
+						atof(GetAttribute("xb").c_str()), atof(GetAttribute("yb").c_str()));
+			path.SetName(wxString::FromUTF8(GetAttribute("name").c_str()));
+
+			string flow = GetAttribute("flow");
+			if (flow == "ab")
+				path.SetFlow(PATHFLOW_AB);
+			else if (flow == "ba")
+				path.SetFlow(PATHFLOW_BA);
+
+			if (this->empty)
+				return true;
+
+			in_path = true;
+		}
+		else if ((depth == 2) && in_path && (this->element == "traffic"))
+		{
+			int time = atoi(GetAttribute("time").c_str());
+			path.GetPathControl()->erase(time);
+			path.InsertControl(time, atof(GetAttribute("speedlimit", "0").c_str()),
+							   atof(GetAttribute("traffic", "1").c_str()), GetAttribute("blocked") == "1");
+		}
+	}
+
+	// The data can only end after the root
+	if (!this->done)
+		this->ok = false;
+
+	return false;
+}
+
+// Return true if the network was read so far without errors
+bool MobSinkReader::IsOk(void)
+{
+	return this->ok;
+}
+
+// Find the next start or end tag, skipping the text, comments, processing
+// instructions and declarations. Returns false at the end of the data.
+bool MobSinkReader::NextElement(void)
+{
+	string_view text(this->data, this->size);
+
+	while (true)
+	{
+		size_t start = text.find('<', this->position);
+		if (start == string_view::npos)
+			return false;
+
+		// What is skipped ends with its own marker
+		const char *marker = NULL;
+		if (text.compare(start, 4, "<!--") == 0)
+			marker = "-->";
+		else if (text.compare(start, 9, "<![CDATA[") == 0)
+			marker = "]]>";
+		else if (text.compare(start, 2, "<?") == 0)
+			marker = "?>";
+		else if (text.compare(start, 2, "<!") == 0)
+			marker = ">";
+
+		size_t end = marker ? text.find(marker, start + 1) : FindTagEnd(start + 1);
+		if (end == string_view::npos)
+		{
+			this->ok = false;
+			return false;
+		}
+
+		if (!marker)
+		{
+			this->position = start;
+			return ParseElement(end);
+		}
+
+		this->position = end + strlen(marker);
+	}
+}
+
+// Find the '>' that ends a tag. The attribute values may have '>' in them.
+size_t MobSinkReader::FindTagEnd(size_t from)
+{
+	for (size_t i = from; i < this->size; i++)
+	{
+		char c = this->data[i];
+		if (c == '>')
+			return i;
+
+		if ((c == '"') || (c == '\''))
+		{
+			const char *quote = (const char *)memchr(this->data + i + 1, c, this->size - i - 1);
+			if (!quote)
+				break;
+
+			i = quote - this->data;
+		}
+	}
+
+	return string::npos;
+}
+
+// Read the name and attributes of the tag at the position, which ends at
+// the '>' at end
+bool MobSinkReader::ParseElement(size_t end)
+{
+	const char *data = this->data;
+	size_t i = this->position + 1;
+
+	this->closing = data[i] == '/';
+	if (this->closing)
+		i++;
+
+	this->empty = data[end - 1] == '/';
+	if (this->empty)
+		end--;
+
+	size_t name = i;
+	while ((i < end) && !IsSpace(data[i]))
+		i++;
+
+	this->element.assign(data + name, i - name);
+	this->nattrs = 0;
+	this->position = end + (this->empty ? 2 : 1);
+
+	if (this->element.empty() || (this->closing && this->empty))
+	{
+		this->ok = false;
+		return false;
+	}
+
+	// name="value" pairs, with either kind of quotes
+	while (true)
+	{
+		while ((i < end) && IsSpace(data[i]))
+			i++;
+
+		if (i >= end)
+			break;
+
+		size_t attr_name = i;
+		while ((i < end) && (data[i] != '=') && !IsSpace(data[i]))
+			i++;
+
+		size_t attr_name_end = i;
+		while ((i < end) && IsSpace(data[i]))
+			i++;
+
+		if ((i >= end) || (data[i] != '='))
+		{
+			this->ok = false;
+			return false;
+		}
+		i++;
+
+		while ((i < end) && IsSpace(data[i]))
+			i++;
+
+		if ((i >= end) || ((data[i] != '"') && (data[i] != '\'')))
+		{
+			this->ok = false;
+			return false;
+		}
+
+		const char *value_end = (const char *)memchr(data + i + 1, data[i], end - i - 1);
+		if (!value_end)
+		{
+			this->ok = false;
+			return false;
+		}
+
+		if (this->nattrs == this->attrs.size())
+			this->attrs.resize(this->nattrs + 1);
+
+		xml_attribute &attr = this->attrs[this->nattrs++];
+		string decoded;
+		attr.name = string_view(data + attr_name, attr_name_end - attr_name);
+		string_view value = OSMReader::DecodeValue(data + i + 1, value_end - (data + i + 1), decoded);
+		attr.value.assign(value.data(), value.size());
+		i = value_end - data + 1;
+	}
+
+	return true;
+}
+
+// Return the value of an attribute of the current element, or the given
+// value if it doesn't have it
+string MobSinkReader::GetAttribute(const char *name, const char *value)
+{
+	for (size_t i = 0; i < this->nattrs; i++)
+	{
+		if (this->attrs[i].name == name)
+			return this->attrs[i].value;
+	}
+
+	return value;
+}
@@ -0,0 +1,318 @@
+/*
+ * MobSink XML network writer implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <MobSinkWriter.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+using namespace std;
+
+// Powers of ten up to the maximum precision
+static const double pow10_table[MOBSINKWRITER_MAX_PRECISION + 1] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12
+};
+
+// Constructor
+MobSinkWriter::MobSinkWriter(FILE *fp, int precision, unsigned int threads)
+{
+	this->fp = fp;
+	this->precision = precision < 0 ? 0 : (precision > MOBSINKWRITER_MAX_PRECISION ? MOBSINKWRITER_MAX_PRECISION : precision);
+	this->buffer.reserve(MOBSINKWRITER_BUFFER_SIZE + 4096);
+	this->written = 0;
+	this->started = false;
+	this->has_paths = false;
+	this->ok = true;
+
+	// A single thread formats the paths as they come
+	if (threads != 1)
+	{
+		this->pool.reset(new ThreadPool(threads));
+		if (this->pool->GetSize() > 1)
+		{
+			this->chunk.reset(new vector<mobsink_path>);
+			this->chunk->reserve(MOBSINKWRITER_CHUNK_SIZE);
+		}
+		else
+			this->pool.reset();
+	}
+}
+
+// Write the XML declaration and the network attributes
+void MobSinkWriter::Begin(long width, long height, long speedlimit)
+{
+	char number[32];
+
+	this->buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<network width=\"";
+	this->buffer.append(number, snprintf(number, sizeof(number), "%ld", width));
+	this->buffer += "\" height=\"";
+	this->buffer.append(number, snprintf(number, sizeof(number), "%ld", height));
+	this->buffer += "\" speedlimit=\"";
+	this->buffer.append(number, snprintf(number, sizeof(number), "%ld", speedlimit));
+	this->buffer += "\"";
+
+	this->started = true;
+}
+
+// Write a path
+void MobSinkWriter::Write(Path &path)
+{
+	// The network element is only closed when it gets its first child
+	if (!this->has_paths)
+	{
+		this->buffer += ">";
+		this->has_paths = true;
+	}
+
+	if (this->pool)
+	{
+		this->chunk->emplace_back();
+		GetPath(path, this->chunk->back());
+		if (this->chunk->size() == MOBSINKWRITER_CHUNK_SIZE)
+			SubmitChunk();
+
+		return;
+	}
+
+	GetPath(path, this->current);
+	FormatPath(this->buffer, this->current, this->precision);
+	if (this->buffer.size() >= MOBSINKWRITER_BUFFER_SIZE)
+		Flush();
+}
+
+// Close the network and flush the buffer
+bool MobSinkWriter::End(void)
+{
+	// Write the chunks still being formatted
+	if (this->pool)
+	{
+		if (!this->chunk->empty())
+			SubmitChunk();
+
+		while (!this->pending.empty())
+			WriteChunk();
+	}
+
+	if (this->has_paths)
+		this->buffer += "\n</network>\n";
+	else
+		this->buffer += "/>\n";
+
+	Flush();
+	if (fflush(this->fp) != 0)
+		this->ok = false;
+
+	return this->ok;
+}
+
+// Return true if Begin() was called
+bool MobSinkWriter::IsStarted(void)
+{
+	return this->started;
+}
+
+// Return the number of bytes written so far
+unsigned long long MobSinkWriter::GetBytesWritten(void)
+{
+	return this->written + this->buffer.size();
+}
+
+// Print a float as "%.*f" would. Up to 12 digits, a float times a power
+// of ten is exact in a double, so rounding it to an integer gives the same
+// digits as printf without its overhead.
+size_t MobSinkWriter::FormatFloat(char *out, float value, int precision)
+{
+	double scaled = (double)value * pow10_table[precision];
+
+	// Too large (or not a number): let printf handle it
+	if (!(fabs(scaled) < 9e18))
+		return snprintf(out, 64, "%.*f", precision, (double)value);
+
+	int64_t rounded = (int64_t)nearbyint(scaled);
+	uint64_t digits = rounded < 0 ? -(uint64_t)rounded : rounded;
+	char reverse[32];
+	size_t n = 0, size = 0;
+
+	// Fractional part, then the integer part (at least one digit)
+	for (int i = 0; i < precision; i++)
+	{
+		reverse[n++] = '0' + digits % 10;
+		digits /= 10;
+	}
+
+	if (precision > 0)
+		reverse[n++] = '.';
+
+	do
+	{
+		reverse[n++] = '0' + digits % 10;
+		digits /= 10;
+	} while (digits > 0);
+
+	// printf keeps the sign of negative values rounded to zero
+	if (signbit(value))
+		out[size++] = '-';
+
+	while (n > 0)
+		out[size++] = reverse[--n];
+
+	out[size] = 0;
+	return size;
+}
+
+// Get what is written of a path
+void MobSinkWriter::GetPath(Path &path, mobsink_path &out)
+{
+	out.name = path.GetName().utf8_str();
+	out.xa = path.GetPointA().GetX();
+	out.ya = path.GetPointA().GetY();
+	out.xb = path.GetPointB().GetX();
+	out.yb = path.GetPointB().GetY();
+	out.oneway = path.GetFlow() == PATHFLOW_AB;
+
+	// The speed limit, if any
+	map<int, struct path_control_params>::iterator control = path.GetPathControl()->find(1);
+	out.has_speedlimit = control != path.GetPathControl()->end();
+	out.speedlimit = out.has_speedlimit ? control->second.speedlimit : 0;
+}
+
+// Append the XML of a path
+void MobSinkWriter::FormatPath(string &out, const mobsink_path &path, int precision)
+{
+	out += "\n  <path name=\"";
+	AppendEscaped(out, path.name.c_str());
+	out += "\" xa=\"";
+	AppendFloat(out, path.xa, precision);
+	out += "\" ya=\"";
+	AppendFloat(out, path.ya, precision);
+	out += "\" xb=\"";
+	AppendFloat(out, path.xb, precision);
+	out += "\" yb=\"";
+	AppendFloat(out, path.yb, precision);
+	out += "\"";
+
+	if (path.oneway)
+		out += " flow=\"ab\"";
+
+	if (path.has_speedlimit)
+	{
+		out += ">\n    <traffic time=\"1\" speedlimit=\"";
+		AppendFloat(out, path.speedlimit, precision);
+		out += "\" traffic=\"1\"/>\n  </path>";
+	}
+	else
+	{
+		out += "/>";
+	}
+}
+
+// Format the XML of a chunk of paths. Runs in the threads of the pool.
+string MobSinkWriter::FormatChunk(const vector<mobsink_path> &paths, int precision)
+{
+	string out;
+	out.reserve(paths.size() * 128);
+
+	for (size_t i = 0; i < paths.size(); i++)
+		FormatPath(out, paths[i], precision);
+
+	return out;
+}
+
+// Append an attribute value, escaped as wxXmlDocument does it
+void MobSinkWriter::AppendEscaped(string &out, const char *data)
+{
+	const char *start = data;
+
+	for (; *data; data++)
+	{
+		const char *entity = NULL;
+
+		switch (*data)
+		{
+		case '<':  entity = "&lt;"; break;
+		case '>':  entity = "&gt;"; break;
+		case '&':  entity = "&amp;"; break;
+		case '"':  entity = "&quot;"; break;
+		case '\r': entity = "&#xD;"; break;
+		case '\t': entity = "&#x9;"; break;
+		case '\n': entity = "&#xA;"; break;
+		}
+
+		if (entity)
+		{
+			out.append(start, data - start);
+			out += entity;
+			start = data + 1;
+		}
+	}
+
+	out.append(start, data - start);
+}
+
+// Append a number
+void MobSinkWriter::AppendFloat(string &out, float value, int precision)
+{
+	char number[64];
+	out.append(number, FormatFloat(number, value, precision));
+}
+
+// Give the current chunk to the pool. What is in the buffer goes before
+// it, so it is written first. A limited number of chunks is kept in
+// memory, writing the oldest ones first.
+void MobSinkWriter::SubmitChunk(void)
+{
+	Flush();
+
+	shared_ptr<vector<mobsink_path> > paths = this->chunk;
+	int precision = this->precision;
+	this->pending.push_back(this->pool->Async<string>([paths, precision]() { return FormatChunk(*paths, precision); }));
+
+	this->chunk.reset(new vector<mobsink_path>);
+	this->chunk->reserve(MOBSINKWRITER_CHUNK_SIZE);
+
+	while (this->pending.size() > this->pool->GetSize() * 2)
+		WriteChunk();
+}
+
+// Write the oldest chunk, waiting for it to be formatted
+void MobSinkWriter::WriteChunk(void)
+{
+	string text = this->pending.front().get();
+	this->pending.pop_front();
+	WriteData(text);
+}
+
+// Write data to the file
+void MobSinkWriter::WriteData(const string &data)
+{
+	if (fwrite(data.data(), 1, data.size(), this->fp) != data.size())
+		this->ok = false;
+
+	this->written += data.size();
+}
+
+// Write the buffer to the file
+void MobSinkWriter::Flush(void)
+{
+	if (this->buffer.empty())
+		return;
+
+	WriteData(this->buffer);
+	this->buffer.clear();
+}
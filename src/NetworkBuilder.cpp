@@ -0,0 +1,456 @@
+/*
+ * MobSink network builder.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <NetworkBuilder.h>
+#include <MobSinkBinaryWriter.h>
+#include <ThreadPool.h>
+#include <math.h>
+#include <stdio.h>
+
+using namespace std;
+
+// Set the map boundaries. If no width or height were given, the network
+// gets the size of the map in meters.
+void NetworkBuilder::SetBounds(const osm_bounds &bounds)
+{
+	this->minlat = bounds.minlat;
+	this->maxlat = bounds.maxlat;
+	this->minlon = bounds.minlon;
+	this->maxlon = bounds.maxlon;
+
+	long int width, height;
+	GetMapSize(this->options.projection, this->minlat, this->minlon, this->maxlat, this->maxlon, width, height);
+	this->options.map_width = this->options.map_width == 0 ? width : this->options.map_width;
+
+	if (this->options.map_height == 0)
+		this->options.map_height = height;
+
+	this->projection_ready = false;
+}
+
+// Return true if a location is inside the boundaries
+bool NetworkBuilder::IsInside(double lat, double lon)
+{
+	return (lat >= this->minlat) && (lat <= this->maxlat) && (lon >= this->minlon) && (lon <= this->maxlon);
+}
+
+// Open the output. The paths are written to it as soon as they are
+// created, unless they must be split into tiles first.
+bool NetworkBuilder::Open(const string &output)
+{
+	this->output = output;
+	if (this->options.tile_rows > 0)
+		return true;
+
+	this->outputfile = fopen(output.c_str(), "wb");
+	if (!this->outputfile)
+		return false;
+
+	this->ownwriter.reset(CreateWriter(this->outputfile, this->options.threads));
+	this->writer = this->ownwriter.get();
+	return true;
+}
+
+// Open a writer of the caller as the output. It can't be split into tiles.
+bool NetworkBuilder::Open(NetworkWriter *writer)
+{
+	if (this->options.tile_rows > 0)
+		return false;
+
+	this->output.clear();
+	this->writer = writer;
+	return true;
+}
+
+// Finish the network, once all the paths were written
+bool NetworkBuilder::Finish(void)
+{
+	if (this->options.crossings != CROSSINGS_IGNORE)
+	{
+		CheckCrossings(this->pending);
+		for (size_t i = 0; i < this->pending.GetSize(); i++)
+		{
+			Path path = this->pending.GetPath(i);
+			OutputPath(path);
+		}
+
+		this->pending.Clear();
+	}
+
+	if (this->options.tile_rows > 0)
+		return WriteTiles();
+
+	if (!this->writer->IsStarted())
+		this->writer->Begin(this->options.map_width, this->options.map_height, this->options.defaultspeed);
+
+	bool ok = this->writer->End();
+	this->counters->bytes_written = this->writer->GetBytesWritten();
+	return ok;
+}
+
+// Close the output. A partial network is not left behind.
+void NetworkBuilder::Close(bool ok)
+{
+	if (this->writer && (this->options.tile_rows == 0))
+		this->counters->bytes_written = this->writer->GetBytesWritten();
+
+	this->writer = NULL;
+	this->ownwriter.reset();
+	this->tiles.clear();
+	this->pending.Clear();
+	this->projection_ready = false;
+
+	if (this->outputfile)
+	{
+		fclose(this->outputfile);
+		this->outputfile = NULL;
+		if (!ok)
+			remove(this->output.c_str());
+	}
+}
+
+// Create the writer of the output format. The XML is formatted by this
+// number of threads (0 for one per core).
+NetworkWriter *NetworkBuilder::CreateWriter(FILE *fp, long int threads)
+{
+	if (this->options.format == OUTPUT_BIN)
+		return new MobSinkBinaryWriter(fp);
+
+	return new MobSinkWriter(fp, this->options.precision, threads);
+}
+
+// Project (and simplify) the nodes of a highway
+void NetworkBuilder::BuildHighway(const highway &road, vector<Point> &points)
+{
+	vector<int64_t> ids;
+	BuildHighway(road, ids, points);
+}
+
+// Project (and simplify) the nodes of a highway, keeping the ids of the
+// nodes that are left
+void NetworkBuilder::BuildHighway(const highway &road, vector<int64_t> &ids, vector<Point> &points)
+{
+	ids.clear();
+	points.clear();
+	this->locations.clear();
+
+	// Nodes outside the boundaries are skipped
+	for (unsigned int i = 0; i < road.refs.size(); i++)
+	{
+		node_location location;
+		if (!this->nodes->Find(road.refs[i], location))
+		{
+			this->counters->refs_missing++;
+			continue;
+		}
+
+		ids.push_back(road.refs[i]);
+		this->locations.push_back(location);
+	}
+
+	// The nodes found are projected together
+	ProjectHighway(this->locations, points);
+
+	if (this->simplifier)
+		this->simplifier->Simplify(ids, points);
+}
+
+// Project the nodes of a highway that were already found
+void NetworkBuilder::ProjectHighway(const vector<node_location> &locations, vector<Point> &points)
+{
+	size_t count = locations.size();
+	this->projected_x.resize(count);
+	this->projected_y.resize(count);
+	ProjectNodes(locations.data(), count, this->projected_x.data(), this->projected_y.data());
+
+	points.clear();
+	points.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		points.push_back(Point(this->projected_x[i], this->projected_y[i]));
+}
+
+// Create the paths of a highway from its points and write them
+void NetworkBuilder::WriteHighway(const highway &road, const vector<Point> &points)
+{
+	// Create the paths between each pair of consecutive nodes
+	for (unsigned int i = 1; i < points.size(); i++)
+	{
+		Path p(points[i - 1], points[i]);
+		p.SetName(wxString::FromUTF8(road.name.c_str()));
+
+		// If it is an one-way road, set its attribute
+		if (road.flow == PATHFLOW_AB)
+			p.SetFlow(road.flow);
+
+		// Set its speed limit
+		if (road.speedlimit > 0)
+			p.InsertControl(1, road.speedlimit, 1, false);
+
+		WritePath(p);
+	}
+}
+
+// Write a path to the output network
+void NetworkBuilder::WritePath(Path &path)
+{
+	// Crossings can only be found once all the paths are known
+	if (this->options.crossings != CROSSINGS_IGNORE)
+		this->pending.Add(path);
+	else
+		OutputPath(path);
+}
+
+// Find the paths that cross without a shared node. They are listed or
+// split at the crossings, as the options say.
+void NetworkBuilder::CheckCrossings(PathStore &paths)
+{
+	vector<path_crossing> crossings;
+	PathSweep sweep(paths);
+	sweep.GetCrossings(crossings);
+	this->counters->crossings += crossings.size();
+
+	if (this->options.crossings == CROSSINGS_REPORT)
+	{
+		for (size_t i = 0; i < crossings.size(); i++)
+		{
+			path_crossing &crossing = crossings[i];
+			fprintf(this->messages, "Crossing at (%f, %f): \"%s\" and \"%s\"\n", crossing.point.GetX(), crossing.point.GetY(),
+					paths.GetName(paths.GetNameId(crossing.a)).utf8_str().data(),
+					paths.GetName(paths.GetNameId(crossing.b)).utf8_str().data());
+		}
+
+		fprintf(this->messages, "%lu crossings found.\n", (unsigned long)crossings.size());
+	}
+	else if (this->options.crossings == CROSSINGS_SPLIT)
+	{
+		PathStore split;
+		PathSweep::Split(paths, crossings, split);
+		fprintf(this->messages, "%lu crossings found, %lu paths added by splitting.\n", (unsigned long)crossings.size(),
+				(unsigned long)(split.GetSize() - paths.GetSize()));
+		swap(paths, split);
+	}
+}
+
+// Send a path to the output file or to its tiles
+void NetworkBuilder::OutputPath(Path &path)
+{
+	if (this->options.tile_rows > 0)
+	{
+		ClipPath(path);
+		return;
+	}
+
+	// The network size is known once the boundaries were read
+	if (!this->writer->IsStarted())
+		this->writer->Begin(this->options.map_width, this->options.map_height, this->options.defaultspeed);
+
+	this->counters->paths++;
+	this->writer->Write(path);
+}
+
+// Set up the tile grid. It needs the boundaries, so it is done when the
+// first path arrives.
+void NetworkBuilder::BeginTiles(void)
+{
+	double tile_lat = (this->maxlat - this->minlat) / this->options.tile_rows;
+	double tile_lon = (this->maxlon - this->minlon) / this->options.tile_columns;
+
+	this->tiles.resize(this->options.tile_rows * this->options.tile_columns);
+
+	for (long int row = 0; row < this->options.tile_rows; row++)
+	{
+		for (long int column = 0; column < this->options.tile_columns; column++)
+		{
+			maptile &tile = this->tiles[row * this->options.tile_columns + column];
+			tile.left = (float)this->options.map_width * column / this->options.tile_columns;
+			tile.right = (float)this->options.map_width * (column + 1) / this->options.tile_columns;
+			tile.top = (float)this->options.map_height * row / this->options.tile_rows;
+			tile.bottom = (float)this->options.map_height * (row + 1) / this->options.tile_rows;
+
+			// Each tile gets the size of its own area (rows start from the top)
+			double lat_a = this->maxlat - tile_lat * (row + 1);
+			double lon_a = this->minlon + tile_lon * column;
+			GetMapSize(this->options.projection, lat_a, lon_a, lat_a + tile_lat, lon_a + tile_lon, tile.width, tile.height);
+		}
+	}
+}
+
+// Add a path to the tiles it crosses, clipped to their edges
+void NetworkBuilder::ClipPath(Path &path)
+{
+	if (this->tiles.empty())
+		BeginTiles();
+
+	float xa = path.GetPointA().GetX(), ya = path.GetPointA().GetY();
+	float dx = path.GetPointB().GetX() - xa, dy = path.GetPointB().GetY() - ya;
+	float tile_width = (float)this->options.map_width / this->options.tile_columns;
+	float tile_height = (float)this->options.map_height / this->options.tile_rows;
+
+	// Range of tiles under the path
+	long int first_column = 0, last_column = this->options.tile_columns - 1;
+	long int first_row = 0, last_row = this->options.tile_rows - 1;
+
+	if (tile_width > 0)
+	{
+		first_column = max(first_column, (long int)floorf(min(xa, xa + dx) / tile_width));
+		last_column = min(last_column, (long int)floorf(max(xa, xa + dx) / tile_width));
+	}
+
+	if (tile_height > 0)
+	{
+		first_row = max(first_row, (long int)floorf(min(ya, ya + dy) / tile_height));
+		last_row = min(last_row, (long int)floorf(max(ya, ya + dy) / tile_height));
+	}
+
+	for (long int row = first_row; row <= last_row; row++)
+	{
+		for (long int column = first_column; column <= last_column; column++)
+		{
+			maptile &tile = this->tiles[row * this->options.tile_columns + column];
+
+			// Liang-Barsky clipping of the segment against the tile
+			float t0 = 0, t1 = 1;
+			float p[4] = { -dx, dx, -dy, dy };
+			float q[4] = { xa - tile.left, tile.right - xa, ya - tile.top, tile.bottom - ya };
+			bool inside = true;
+
+			for (unsigned int i = 0; (i < 4) && inside; i++)
+			{
+				if (p[i] == 0)
+					inside = (q[i] >= 0);
+				else if (p[i] < 0)
+					t0 = max(t0, q[i] / p[i]);
+				else
+					t1 = min(t1, q[i] / p[i]);
+			}
+
+			// Paths touching the tile at a single point are left out
+			if (!inside || (t0 >= t1))
+				continue;
+
+			// Convert to the tile's coordinates
+			float scale_x = (tile.right > tile.left) ? tile.width / (tile.right - tile.left) : 1;
+			float scale_y = (tile.bottom > tile.top) ? tile.height / (tile.bottom - tile.top) : 1;
+
+			Path clipped = path;
+			clipped.SetPointA(Point((xa + t0 * dx - tile.left) * scale_x, (ya + t0 * dy - tile.top) * scale_y));
+			clipped.SetPointB(Point((xa + t1 * dx - tile.left) * scale_x, (ya + t1 * dy - tile.top) * scale_y));
+			tile.paths.Add(clipped);
+		}
+	}
+}
+
+// Write all the tiles in parallel
+bool NetworkBuilder::WriteTiles(void)
+{
+	if (this->tiles.empty())
+		BeginTiles();
+
+	// Tiles are named after the output file: map.xml gives map_0_0.xml, ...
+	string base = this->output, extension;
+	size_t dot = this->output.rfind('.');
+	if ((dot != string::npos) && ((this->output.find_last_of("/\\") == string::npos) || (dot > this->output.find_last_of("/\\"))))
+	{
+		base = this->output.substr(0, dot);
+		extension = this->output.substr(dot);
+	}
+
+	ThreadPool pool(this->options.threads);
+	vector<std::future<bool> > results;
+
+	for (long int row = 0; row < this->options.tile_rows; row++)
+	{
+		for (long int column = 0; column < this->options.tile_columns; column++)
+		{
+			maptile *tile = &this->tiles[row * this->options.tile_columns + column];
+			string name = base + "_" + to_string(row) + "_" + to_string(column) + extension;
+			results.push_back(pool.Async<bool>([this, tile, name]() { return WriteTile(*tile, name); }));
+		}
+	}
+
+	bool ok = true;
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		ok = results[i].get() && ok;
+		this->counters->paths += this->tiles[i].paths.GetSize();
+		this->counters->bytes_written += this->tiles[i].bytes;
+	}
+
+	fprintf(this->messages, "%ld tiles written.\n", this->options.tile_rows * this->options.tile_columns);
+	return ok;
+}
+
+// Write the network of a single tile
+bool NetworkBuilder::WriteTile(maptile &tile, const string &output)
+{
+	FILE *outputfile = fopen(output.c_str(), "wb");
+	if (!outputfile)
+		return false;
+
+	// The tiles are already written in parallel
+	unique_ptr<NetworkWriter> writer(CreateWriter(outputfile, 1));
+	writer->Begin(tile.width, tile.height, this->options.defaultspeed);
+
+	for (size_t i = 0; i < tile.paths.GetSize(); i++)
+	{
+		Path path = tile.paths.GetPath(i);
+		writer->Write(path);
+	}
+
+	bool ok = writer->End();
+	tile.bytes = writer->GetBytesWritten();
+	writer.reset();
+	ok = (fclose(outputfile) == 0) && ok;
+	if (!ok)
+		remove(output.c_str());
+
+	return ok;
+}
+
+// Convert a node location to MobSink coordinates
+Point NetworkBuilder::Project(const node_location &location)
+{
+	float x, y;
+	ProjectNodes(&location, 1, &x, &y);
+	return Point(x, y);
+}
+
+// Convert node locations to MobSink coordinates (the y coordinates start
+// from the top)
+void NetworkBuilder::ProjectNodes(const node_location *locations, size_t count, float *x, float *y)
+{
+	// The boundaries and size may be set after SetBounds() (from a state)
+	if (!this->projection_ready)
+	{
+		this->projection.Setup(this->options.projection, this->minlat, this->maxlat, this->minlon, this->maxlon,
+				this->options.map_width, this->options.map_height);
+		this->projection_ready = true;
+	}
+
+	this->projection.Project(locations, count, x, y);
+}
+
+// Get map size in meters from latitude and longitude
+void NetworkBuilder::GetMapSize(projectiontype projection, double lat_a, double lon_a, double lat_b, double lon_b,
+		long int &width, long int &height)
+{
+	double size_x, size_y;
+	Projection::GetSize(projection, min(lat_a, lat_b), max(lat_a, lat_b), min(lon_a, lon_b), max(lon_a, lon_b), size_x, size_y);
+	width = (long int)size_x;
+	height = (long int)size_y;
+}
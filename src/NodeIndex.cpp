@@ -0,0 +1,227 @@
+/*
+ * Node location index implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <NodeIndex.h>
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+// Constructor
+NodeIndex::NodeIndex()
+{
+	Clear();
+}
+
+// Remove all the nodes
+void NodeIndex::Clear(void)
+{
+	vector<node_entry>().swap(this->entries);
+	vector<node_location>().swap(this->table);
+	this->first = 0;
+	this->count = 0;
+	this->sorted = true;
+	this->prepared = true;
+}
+
+// Insert a node. If the id is already there, the new location replaces the old one.
+void NodeIndex::Insert(int64_t id, double lat, double lon)
+{
+	node_entry entry;
+	entry.id = id;
+	entry.location.lat = ToFixed(lat);
+	entry.location.lon = ToFixed(lon);
+
+	if (!this->entries.empty() && (id <= this->entries.back().id))
+		this->sorted = false;
+
+	this->entries.push_back(entry);
+	this->prepared = false;
+}
+
+// Find the location of a node
+bool NodeIndex::Find(int64_t id, node_location &location)
+{
+	if (!this->prepared)
+		Prepare();
+
+	// Dense table
+	if (!this->table.empty())
+	{
+		if ((id < this->first) || ((uint64_t)(id - this->first) >= this->table.size()))
+			return false;
+
+		location = this->table[id - this->first];
+		return location.lat != NODEINDEX_EMPTY;
+	}
+
+	// Sorted array
+	size_t low = 0, high = this->entries.size();
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (this->entries[middle].id < id)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if ((low == this->entries.size()) || (this->entries[low].id != id))
+		return false;
+
+	location = this->entries[low].location;
+	return true;
+}
+
+// Remove a node (if it is there)
+void NodeIndex::Remove(int64_t id)
+{
+	if (!this->prepared)
+		Prepare();
+
+	if (!this->table.empty())
+	{
+		if ((id >= this->first) && ((uint64_t)(id - this->first) < this->table.size()) && (this->table[id - this->first].lat != NODEINDEX_EMPTY))
+		{
+			this->table[id - this->first].lat = NODEINDEX_EMPTY;
+			this->table[id - this->first].lon = NODEINDEX_EMPTY;
+			this->count--;
+		}
+		return;
+	}
+
+	node_entry key;
+	key.id = id;
+	vector<node_entry>::iterator it = lower_bound(this->entries.begin(), this->entries.end(), key,
+			[](const node_entry &a, const node_entry &b) { return a.id < b.id; });
+
+	if ((it != this->entries.end()) && (it->id == id))
+	{
+		this->entries.erase(it);
+		this->count--;
+	}
+}
+
+// Return the number of nodes
+size_t NodeIndex::GetSize(void)
+{
+	if (!this->prepared)
+		Prepare();
+
+	return this->count;
+}
+
+// Return true if the index is using the dense table
+bool NodeIndex::IsDense(void)
+{
+	if (!this->prepared)
+		Prepare();
+
+	return !this->table.empty();
+}
+
+// Convert degrees to fixed point
+int32_t NodeIndex::ToFixed(double degrees)
+{
+	return (int32_t)lround(degrees * NODEINDEX_SCALE);
+}
+
+// Convert fixed point to degrees
+double NodeIndex::ToDegrees(int32_t fixed)
+{
+	return fixed / NODEINDEX_SCALE;
+}
+
+// Sort the inserted nodes and choose the index layout. The lookups do it
+// when there are new nodes, so it only needs to be called by itself before
+// the index is shared by threads.
+void NodeIndex::Prepare(void)
+{
+	if (this->prepared)
+		return;
+
+	// Nodes inserted after the table was built go back to the array
+	if (!this->table.empty())
+	{
+		vector<node_entry> entries;
+		entries.reserve(this->count + this->entries.size());
+
+		for (size_t i = 0; i < this->table.size(); i++)
+		{
+			if (this->table[i].lat == NODEINDEX_EMPTY)
+				continue;
+
+			node_entry entry;
+			entry.id = this->first + i;
+			entry.location = this->table[i];
+			entries.push_back(entry);
+		}
+
+		if (!this->entries.empty() && !entries.empty() && (this->entries.front().id <= entries.back().id))
+			this->sorted = false;
+
+		entries.insert(entries.end(), this->entries.begin(), this->entries.end());
+		this->entries.swap(entries);
+		vector<node_location>().swap(this->table);
+	}
+
+	// Sort by id (the last of the repeated ids wins)
+	if (!this->sorted)
+	{
+		stable_sort(this->entries.begin(), this->entries.end(),
+				[](const node_entry &a, const node_entry &b) { return a.id < b.id; });
+
+		size_t n = 0;
+		for (size_t i = 0; i < this->entries.size(); i++)
+		{
+			if ((i + 1 < this->entries.size()) && (this->entries[i + 1].id == this->entries[i].id))
+				continue;
+
+			this->entries[n++] = this->entries[i];
+		}
+
+		this->entries.resize(n);
+		this->sorted = true;
+	}
+
+	this->count = this->entries.size();
+	this->prepared = true;
+
+	if (this->entries.empty())
+		return;
+
+	// Are the ids dense enough for a direct table?
+	uint64_t range = (uint64_t)(this->entries.back().id - this->entries.front().id) + 1;
+	if (range > (uint64_t)this->entries.size() * NODEINDEX_DENSITY)
+	{
+		this->entries.shrink_to_fit();
+		return;
+	}
+
+	node_location empty;
+	empty.lat = NODEINDEX_EMPTY;
+	empty.lon = NODEINDEX_EMPTY;
+
+	this->first = this->entries.front().id;
+	this->table.assign(range, empty);
+
+	for (size_t i = 0; i < this->entries.size(); i++)
+		this->table[this->entries[i].id - this->first] = this->entries[i].location;
+
+	vector<node_entry>().swap(this->entries);
+}
@@ -0,0 +1,127 @@
+/*
+ * Node id set implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <NodeSet.h>
+#include <algorithm>
+
+using namespace std;
+
+// Constructor
+NodeSet::NodeSet()
+{
+	Clear();
+}
+
+// Remove all the ids
+void NodeSet::Clear(void)
+{
+	vector<int64_t>().swap(this->ids);
+	vector<uint64_t>().swap(this->bits);
+	this->first = 0;
+	this->compacted = 0;
+	this->count = 0;
+	this->prepared = true;
+}
+
+// Insert an id
+void NodeSet::Insert(int64_t id)
+{
+	this->ids.push_back(id);
+	this->prepared = false;
+
+	// Ways share many nodes, so don't let the repeated ids pile up
+	if (this->ids.size() >= 2 * this->compacted + 1024 * 1024)
+		Compact();
+}
+
+// Return true if the id is in the set
+bool NodeSet::Contains(int64_t id)
+{
+	if (!this->prepared)
+		Prepare();
+
+	if (!this->bits.empty())
+	{
+		if ((id < this->first) || ((uint64_t)(id - this->first) >= this->bits.size() * 64))
+			return false;
+
+		uint64_t bit = id - this->first;
+		return (this->bits[bit / 64] >> (bit % 64)) & 1;
+	}
+
+	return binary_search(this->ids.begin(), this->ids.end(), id);
+}
+
+// Return the number of ids
+size_t NodeSet::GetSize(void)
+{
+	if (!this->prepared)
+		Prepare();
+
+	return this->count;
+}
+
+// Sort the ids and remove the repeated ones
+void NodeSet::Compact(void)
+{
+	sort(this->ids.begin(), this->ids.end());
+	this->ids.erase(unique(this->ids.begin(), this->ids.end()), this->ids.end());
+	this->compacted = this->ids.size();
+}
+
+// Compact the ids and choose the set layout
+void NodeSet::Prepare(void)
+{
+	// Ids inserted after the bitset was built go back to the array
+	if (!this->bits.empty())
+	{
+		for (size_t i = 0; i < this->bits.size() * 64; i++)
+		{
+			if ((this->bits[i / 64] >> (i % 64)) & 1)
+				this->ids.push_back(this->first + i);
+		}
+
+		vector<uint64_t>().swap(this->bits);
+	}
+
+	Compact();
+	this->count = this->ids.size();
+	this->prepared = true;
+
+	if (this->ids.empty())
+		return;
+
+	// Are the ids dense enough for a bitset?
+	uint64_t range = (uint64_t)(this->ids.back() - this->ids.front()) + 1;
+	if (range > (uint64_t)this->ids.size() * NODESET_DENSITY)
+	{
+		this->ids.shrink_to_fit();
+		return;
+	}
+
+	this->first = this->ids.front();
+	this->bits.assign((range + 63) / 64, 0);
+
+	for (size_t i = 0; i < this->ids.size(); i++)
+	{
+		uint64_t bit = this->ids[i] - this->first;
+		this->bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+	}
+
+	vector<int64_t>().swap(this->ids);
+}
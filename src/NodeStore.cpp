@@ -0,0 +1,161 @@
+/*
+ * On-disk node store implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <NodeStore.h>
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+// The latitudes are stored with the sign bit flipped, so that the holes
+// of the file (zeros) read as NODEINDEX_EMPTY
+#define NODESTORE_FLIP INT32_MIN
+
+// Move to a position of the file, which may be past 2 GB
+static bool Seek(FILE *fp, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Constructor
+NodeStore::NodeStore()
+{
+	this->file = NULL;
+	this->run_first = 0;
+	this->capacity = 0;
+	this->ok = false;
+}
+
+// Destructor
+NodeStore::~NodeStore()
+{
+	Close();
+}
+
+// Create the file. About this many bytes of nodes are kept until they
+// are written.
+bool NodeStore::Open(const string &filename, size_t memory)
+{
+	Close();
+
+	this->file = fopen(filename.c_str(), "w+b");
+	if (!this->file)
+		return false;
+
+	this->filename = filename;
+	this->capacity = max(memory / sizeof(node_location), (size_t)4096);
+	this->run.reserve(this->capacity);
+	this->ok = true;
+	return true;
+}
+
+// Insert a node. If the id is already there, the new location replaces the old one.
+void NodeStore::Insert(int64_t id, double lat, double lon)
+{
+	if (id < 0)
+	{
+		this->negative.Insert(id, lat, lon);
+		return;
+	}
+
+	node_location location;
+	location.lat = NodeIndex::ToFixed(lat) ^ NODESTORE_FLIP;
+	location.lon = NodeIndex::ToFixed(lon);
+
+	// A node in the run is replaced there
+	if (!this->run.empty() && (id >= this->run_first) && (id < this->run_first + (int64_t)this->run.size()))
+	{
+		this->run[id - this->run_first] = location;
+		return;
+	}
+
+	// Anything but the next id (or a full run) starts a new run
+	if (!this->run.empty() && ((id != this->run_first + (int64_t)this->run.size()) || (this->run.size() == this->capacity)))
+		Flush();
+
+	if (this->run.empty())
+		this->run_first = id;
+
+	this->run.push_back(location);
+}
+
+// Write the last nodes and map the file for the lookups
+bool NodeStore::Finish(void)
+{
+	if (!Flush() | (fclose(this->file) != 0))
+		this->ok = false;
+
+	this->file = NULL;
+
+	vector<node_location>().swap(this->run);
+
+	// An empty file can't be mapped, but then nothing can be found anyway
+	this->mapping.Open(this->filename.c_str());
+	return this->ok;
+}
+
+// Find the location of a node
+bool NodeStore::Find(int64_t id, node_location &location)
+{
+	if (id < 0)
+		return this->negative.Find(id, location);
+
+	if ((uint64_t)id >= this->mapping.GetSize() / sizeof(node_location))
+		return false;
+
+	memcpy(&location, (const char *)this->mapping.GetData() + id * sizeof(node_location), sizeof(node_location));
+	location.lat ^= NODESTORE_FLIP;
+	return location.lat != NODEINDEX_EMPTY;
+}
+
+// Remove the file
+void NodeStore::Close(void)
+{
+	this->mapping.Close();
+	if (this->file)
+		fclose(this->file);
+
+	this->file = NULL;
+	this->negative.Clear();
+	vector<node_location>().swap(this->run);
+
+	if (!this->filename.empty())
+		remove(this->filename.c_str());
+
+	this->filename.clear();
+	this->ok = false;
+}
+
+// Write the run where it belongs in the file
+bool NodeStore::Flush(void)
+{
+	if (this->run.empty())
+		return this->ok;
+
+	size_t size = this->run.size() * sizeof(node_location);
+	if (!Seek(this->file, (uint64_t)this->run_first * sizeof(node_location)) ||
+		(fwrite(this->run.data(), 1, size, this->file) != size))
+		this->ok = false;
+
+	this->run.clear();
+	return this->ok;
+}
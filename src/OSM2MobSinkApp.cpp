@@ -17,274 +17,262 @@
  */
 
 #include <OSM2MobSinkApp.h>
-#include <Path.h>
-#include <Point.h>
-#include <wx/xml/xml.h>
-#include <map>
-#include <vector>
-#include <math.h>
+#include <BatchRunner.h>
 
 using namespace std;
 
-// Program initialization
-bool OSM2MobSinkApp::OnInit()
+// Program entry point. There is no wxApp, but wxWidgets must still be
+// initialized: without it, there is no message output, so the command
+// line parser would print neither the help nor its errors.
+int main(int argc, char **argv)
 {
-	if (!wxApp::OnInit())
-		return false;
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk())
+	{
+		fprintf(stderr, "wxWidgets could not be initialized.\n");
+		return 1;
+	}
 
-	SetAppName(wxT("OpenStreetMap to MobSink converter"));
-	SetVendorName(wxT("LARA"));
-	wxLocale app_locale(wxLANGUAGE_ENGLISH_US);
+	OSM2MobSinkApp app;
+	return app.Run(argc, argv);
+}
+
+// Parse the command line and run the conversion (or the batch)
+int OSM2MobSinkApp::Run(int argc, char **argv)
+{
+	// must refuse '/' as parameter starter or cannot use "/path" style paths
+	wxCmdLineParser parser(g_cmdLineDesc, argc, argv);
+	parser.SetSwitchChars(wxT("-"));
+
+	// The help is shown when it was asked for or the arguments are wrong
+	int parsed = parser.Parse();
+	if (parsed != 0)
+		return (parsed < 0) ? 0 : 1;
+
+	if (!OnCmdLineParsed(parser))
+		return 1;
+
+	// A batch reports each of its jobs
+	if (!this->batchfile.IsEmpty())
+	{
+		BatchRunner batch(this->converter.options, this->converter.rules, this->converter.tolerance, this->converter.threads);
+		if (!batch.Run(this->batchfile))
+		{
+			wxPrintf(wxT("Some of the jobs could not be converted.\n"));
+			return 1;
+		}
+
+		return 0;
+	}
 
 	// Do the conversion
-	if (Convert(inputfile, outputfile))
-		wxPrintf(wxT("Conversion successful!\n"));
-	else
+	if (!this->converter.Run())
+	{
 		wxPrintf(wxT("The input file could not be converted. Check if it is a valid OpenStreetMap XML file.\n"));
+		return 1;
+	}
 
-	return false;
+	wxPrintf(wxT("Conversion successful!\n"));
+	return 0;
 }
 
-// Command line init
-void OSM2MobSinkApp::OnInitCmdLine(wxCmdLineParser& parser)
+// Get an option with a file name, in the form it is opened with
+static bool FoundFile(wxCmdLineParser &parser, const wxString &name, string &value)
 {
-	parser.SetDesc(g_cmdLineDesc);
-	// must refuse '/' as parameter starter or cannot use "/path" style paths
-	parser.SetSwitchChars(wxT("-"));
+	wxString found;
+	if (!parser.Found(name, &found))
+		return false;
+
+	value = (const char *)found.fn_str();
+	return true;
 }
 
 // Command line parser
 bool OSM2MobSinkApp::OnCmdLineParsed(wxCmdLineParser& parser)
 {
+	Converter &converter = this->converter;
+
 	// Get command line arguments
-	bool input = parser.Found(wxT("i"), &this->inputfile);
-	bool output = parser.Found(wxT("o"), &this->outputfile);
-	parser.Found(wxT("nh"), &this->map_height);
-	parser.Found(wxT("nw"), &this->map_width);
-	parser.Found(wxT("s"), &this->defaultspeed);
+	bool input = FoundFile(parser, wxT("i"), converter.inputfile);
+	bool output = FoundFile(parser, wxT("o"), converter.outputfile);
+	parser.Found(wxT("nh"), &converter.options.map_height);
+	parser.Found(wxT("nw"), &converter.options.map_width);
+	parser.Found(wxT("s"), &converter.options.defaultspeed);
+	parser.Found(wxT("t"), &converter.threads);
+	converter.options.threads = converter.threads;
+	converter.twopass = parser.Found(wxT("tp"));
+	parser.Found(wxT("p"), &converter.options.precision);
+	parser.Found(wxT("sp"), &converter.tolerance);
+
+	converter.network_input = parser.Found(wxT("ni"));
+
+	wxString format;
+	if (parser.Found(wxT("f"), &format))
+	{
+		if (format.Lower() == wxT("bin"))
+			converter.options.format = OUTPUT_BIN;
+		else if (format.Lower() != wxT("xml"))
+		{
+			wxPrintf(wxT("The output format must be xml or bin.\n"));
+			return false;
+		}
+	}
 
-	// Verify if everything is OK
-	if (input && output)
+	wxString crossings;
+	if (parser.Found(wxT("cx"), &crossings))
 	{
-		// All parameters were set. Start conversion.
-		wxPrintf(wxT("OpenStreetMap file: %s\n"), this->inputfile.c_str());
-		wxPrintf(wxT("MobSink file: %s\n"), this->outputfile.c_str());
+		if (crossings.Lower() == wxT("report"))
+			converter.options.crossings = CROSSINGS_REPORT;
+		else if (crossings.Lower() == wxT("split"))
+			converter.options.crossings = CROSSINGS_SPLIT;
+		else
+		{
+			wxPrintf(wxT("The crossings must be report or split.\n"));
+			return false;
+		}
 	}
-	else
+
+	wxString projection;
+	if (parser.Found(wxT("pj"), &projection))
 	{
-		// Some parameter is missing. Display an error message.
-		wxPrintf(wxT("You must specify input and output files. Use -h argument to get help.\n"));
-		return false;
+		if (projection.Lower() == wxT("equirectangular"))
+			converter.options.projection = PROJECTION_EQUIRECTANGULAR;
+		else if (projection.Lower() == wxT("mercator"))
+			converter.options.projection = PROJECTION_MERCATOR;
+		else if (projection.Lower() == wxT("tm"))
+			converter.options.projection = PROJECTION_TRANSVERSE_MERCATOR;
+		else
+		{
+			wxPrintf(wxT("The projection must be equirectangular, mercator or tm.\n"));
+			return false;
+		}
 	}
 
-	return true;
-}
+	parser.Found(wxT("mc"), &converter.min_component);
+	converter.contract = parser.Found(wxT("ct"));
+	parser.Found(wxT("ml"), &converter.memory_limit);
 
-// Convert a OpenStreetMap XML file to MobSink XML
-bool OSM2MobSinkApp::Convert(wxString input, wxString output)
-{
-	// Open the XML file
-	wxXmlDocument inputdoc(input);
+	FoundFile(parser, wxT("sf"), converter.statefile);
+	FoundFile(parser, wxT("ac"), converter.changesfile);
+	FoundFile(parser, wxT("c"), converter.cachedir);
+	parser.Found(wxT("b"), &this->batchfile);
 
-	if ((!inputdoc.IsOk()) || (inputdoc.GetRoot()->GetName() != wxT("osm")))
+	string rulesfile;
+	if (FoundFile(parser, wxT("r"), rulesfile) && !converter.rules.Load(rulesfile))
 		return false;
 
-	wxXmlNode *root = inputdoc.GetRoot();
-	if (root->GetName() != wxT("osm"))
+	if (FoundFile(parser, wxT("st"), converter.statsfile))
+		ConversionStats::EnableAllocationCount();
+
+	wxString tiles;
+	if (parser.Found(wxT("tl"), &tiles))
+	{
+		tiles = tiles.Lower();
+		if (!tiles.BeforeFirst('x').ToLong(&converter.options.tile_rows) || !tiles.AfterFirst('x').ToLong(&converter.options.tile_columns) ||
+			(converter.options.tile_rows < 1) || (converter.options.tile_columns < 1))
+		{
+			wxPrintf(wxT("The tiles must be given as ROWSxCOLUMNS, like 2x3.\n"));
+			return false;
+		}
+	}
+
+	// Verify if everything is OK
+	if (converter.threads < 0)
+	{
+		wxPrintf(wxT("The number of threads must not be negative.\n"));
+		return false;
+	}
+
+	if (converter.tolerance < 0)
+	{
+		wxPrintf(wxT("The simplification tolerance must not be negative.\n"));
 		return false;
+	}
 
-	// Prepare some structures
-	map<int, Point> nodes;
-	vector<Path> paths;
-	float minlat = 0, maxlat = 0, minlon = 0, maxlon = 0;
+	if (converter.min_component < 0)
+	{
+		wxPrintf(wxT("The minimum component size must not be negative.\n"));
+		return false;
+	}
 
-	// Read map data
-	wxXmlNode *child = root->GetChildren();
-	while (child)
+	if (converter.memory_limit < 0)
 	{
-		// Boundaries
-		if (child->GetName() == wxT("bounds"))
-		{
-			minlat = atof(child->GetAttribute(wxT("minlat")));
-			maxlat = atof(child->GetAttribute(wxT("maxlat")));
-			minlon = atof(child->GetAttribute(wxT("minlon")));
-			maxlon = atof(child->GetAttribute(wxT("maxlon")));
+		wxPrintf(wxT("The memory limit must not be negative.\n"));
+		return false;
+	}
 
-			// After reading the boundaries of the map, it's time to determine the MobSink network size
-			// If no height or width were specified, calculate default values
-			wxSize map_size = GetMapSize(minlat, minlon, maxlat, maxlon);
-			this->map_width = this->map_width == 0 ? map_size.x : this->map_width;
+	// Slim mode only keeps the input on disk, and these need all of it (or all the paths) in memory
+	if ((converter.memory_limit > 0) && (converter.twopass || converter.network_input || !converter.statefile.empty() || !converter.cachedir.empty() ||
+		(converter.tolerance > 0) || (converter.min_component > 0) || converter.contract || (converter.options.crossings != CROSSINGS_IGNORE) ||
+		(converter.options.tile_rows > 0)))
+	{
+		wxPrintf(wxT("The memory limit can't be combined with two pass, network input, state, cache, simplification, road graph, crossings or tiles options.\n"));
+		return false;
+	}
 
-			if (this->map_height == 0)
-				this->map_height = map_size.y;
+	if ((converter.options.precision < 0) || (converter.options.precision > MOBSINKWRITER_MAX_PRECISION))
+	{
+		wxPrintf(wxT("The precision must be between 0 and %d digits.\n"), MOBSINKWRITER_MAX_PRECISION);
+		return false;
+	}
 
-		}
-		// Nodes
-		else if (child->GetName() == wxT("node"))
-		{
-			int id = atoi(child->GetAttribute(wxT("id")));
-			float lat = atof(child->GetAttribute(wxT("lat")));
-			float lon = atof(child->GetAttribute(wxT("lon")));
-
-			// Discard this node if it is outside the boundaries of the exported map
-			if ((lat < minlat) || (lat > maxlat) || (lon < minlon) || (lon > maxlon))
-			{
-				child = child->GetNext();
-				continue;
-			}
-
-			// Normalize the coordinates
-			lat -= minlat;
-			lon -= minlon;
-
-			// Correct the vertical mirroring (in MobSink, the y coordinates starts from the top)
-			lat = (maxlat - minlat) - lat;
-
-			// Make it proportional to MobSink network size
-			lat = (this->map_height * lat) / (maxlat - minlat);
-			lon = (this->map_width * lon) / (maxlon - minlon);
-
-			Point p(lon, lat);
-			nodes[id] = p;
-		}
-		// Ways
-		else if (child->GetName() == wxT("way"))
-		{
-			wxXmlNode *nodechild = child->GetChildren();
-			vector<Path> way;
-			Point a, b;
-			int id;
-			bool insert_way = false;
-			pathflow flow = PATHFLOW_BI;
-			float speedlimit = 0;
-			wxString name = wxEmptyString;
-
-			// Get the first node
-			while (nodechild && nodechild->GetName() == wxT("nd"))
-			{
-				id = atoi(nodechild->GetAttribute(wxT("ref")));
-				if (nodes.find(id) == nodes.end())
-				{
-					nodechild = nodechild->GetNext();
-					continue;
-				}
-
-				a = nodes[id];
-				nodechild = nodechild->GetNext();
-				break;
-			}
-
-			// Get the following nodes and create paths
-			while (nodechild)
-			{
-				// Nodes
-				if (nodechild->GetName() == wxT("nd"))
-				{
-					id = atoi(nodechild->GetAttribute(wxT("ref")));
-					if (nodes.find(id) == nodes.end())
-					{
-						nodechild = nodechild->GetNext();
-						continue;
-					}
-
-					b = nodes[id];
-					Path p(a, b);
-					way.push_back(p);
-					a = b;
-				}
-				// Tags
-				else if (nodechild->GetName() == wxT("tag"))
-				{
-					// Only insert a way if it is a highway (roads, streets, etc.)
-					if (nodechild->GetAttribute(wxT("k")) == wxT("highway"))
-						insert_way = true;
-
-					// Is this an one-way road?
-					if ((nodechild->GetAttribute(wxT("k")) == wxT("oneway")) && (nodechild->GetAttribute(wxT("v")) == wxT("yes")))
-						flow = PATHFLOW_AB;
-
-					// Does it have a speed limit?
-					if (nodechild->GetAttribute(wxT("k")) == wxT("maxspeed"))
-						speedlimit = atof(nodechild->GetAttribute(wxT("v")));
-
-					// Does it have a name?
-					if (nodechild->GetAttribute(wxT("k")) == wxT("name"))
-						name = nodechild->GetAttribute(wxT("v"));
-				}
-
-				nodechild = nodechild->GetNext();
-			}
-
-			// If this way is a highway, insert it
-			if (insert_way)
-			{
-				for (unsigned int i = 0; i < way.size(); i++)
-				{
-					way.at(i).SetName(name);
-
-					// If it is an one-way road, set its attribute
-					if (flow == PATHFLOW_AB)
-						way.at(i).SetFlow(flow);
-
-					// Set its speed limit
-					if (speedlimit > 0)
-						way.at(i).InsertControl(1, speedlimit, 1, false);
-				}
-
-				paths.insert(paths.end(), way.begin(), way.end());
-			}
-		}
+	if (!converter.changesfile.empty() && converter.statefile.empty())
+	{
+		wxPrintf(wxT("The changes must be applied to a state given with --state.\n"));
+		return false;
+	}
 
-		child = child->GetNext();
+	if (!converter.statefile.empty() && (converter.twopass || converter.network_input))
+	{
+		wxPrintf(wxT("The state can't be kept in two pass mode or when converting a network.\n"));
+		return false;
 	}
 
-	// At this point, we have all the paths.
-	// Now it's time to create the output file.
-	wxXmlDocument outputdoc;
-	root = new wxXmlNode(NULL, wxXML_ELEMENT_NODE, wxT("network"));
+	// The graph changes the paths, so they would no longer match the state
+	if (((converter.min_component > 0) || converter.contract) && (!converter.statefile.empty() || converter.network_input))
+	{
+		wxPrintf(wxT("The road graph can't be built when keeping the state or when converting a network.\n"));
+		return false;
+	}
 
-	// Insert network size
-	root->AddAttribute(wxT("width"), wxString::Format(wxT("%ld"), this->map_width));
-	root->AddAttribute(wxT("height"), wxString::Format(wxT("%ld"), this->map_height));
-	root->AddAttribute(wxT("speedlimit"), wxString::Format(wxT("%ld"), this->defaultspeed));
+	// The cache only has the nodes used by highways, but the state needs all of them
+	if (!converter.cachedir.empty() && !converter.statefile.empty())
+	{
+		wxPrintf(wxT("The cache can't be used when keeping the state.\n"));
+		return false;
+	}
 
-	// Insert the paths in the root XML node
-	for (unsigned int i = 0; i < paths.size(); i++)
+	// The jobs of a batch bring their own files
+	if (!this->batchfile.IsEmpty())
 	{
-		wxXmlNode *newnode = new wxXmlNode(root, wxXML_ELEMENT_NODE, wxT("path"));
-
-		newnode->AddAttribute(wxT("name"), paths.at(i).GetName());
-		newnode->AddAttribute(wxT("xa"), wxString::Format(wxT("%f"), paths.at(i).GetPointA().GetX()));
-		newnode->AddAttribute(wxT("ya"), wxString::Format(wxT("%f"), paths.at(i).GetPointA().GetY()));
-		newnode->AddAttribute(wxT("xb"), wxString::Format(wxT("%f"), paths.at(i).GetPointB().GetX()));
-		newnode->AddAttribute(wxT("yb"), wxString::Format(wxT("%f"), paths.at(i).GetPointB().GetY()));
-		if (paths.at(i).GetFlow() == PATHFLOW_AB)
-			newnode->AddAttribute(wxT("flow"), wxT("ab"));
-
-		// Set the speed limit if any
-		if (paths.at(i).GetPathControl()->find(1) != paths.at(i).GetPathControl()->end())
+		if (input || output || converter.twopass || converter.network_input || !converter.statsfile.empty() || !converter.statefile.empty() ||
+			!converter.changesfile.empty() || !converter.cachedir.empty() || (converter.min_component > 0) || converter.contract || (converter.memory_limit > 0) ||
+			(converter.options.crossings != CROSSINGS_IGNORE))
 		{
-			wxXmlNode *traffic = new wxXmlNode(newnode, wxXML_ELEMENT_NODE, wxT("traffic"));
-			traffic->AddAttribute(wxT("time"), wxT("1"));
-			traffic->AddAttribute(wxT("speedlimit"), wxString::Format(wxT("%f"), paths.at(i).GetPathControl()->at(1).speedlimit));
-			traffic->AddAttribute(wxT("traffic"), wxT("1"));
+			wxPrintf(wxT("A batch can't be combined with input, output, two pass, network input, stats, state, cache, road graph, memory limit or crossings options.\n"));
+			return false;
 		}
+
+		wxPrintf(wxT("Batch manifest: %s\n"), this->batchfile.c_str());
+		return true;
 	}
 
-	outputdoc.SetRoot(root);
-	bool saved = outputdoc.Save(output);
+	if ((input || !converter.changesfile.empty()) && output)
+	{
+		// All parameters were set. Start conversion.
+		if (converter.changesfile.empty())
+			wxPrintf(wxT("OpenStreetMap file: %s\n"), converter.inputfile.c_str());
+		else
+			wxPrintf(wxT("OpenStreetMap change file: %s\n"), converter.changesfile.c_str());
 
-	return saved;
-}
+		wxPrintf(wxT("MobSink file: %s\n"), converter.outputfile.c_str());
+	}
+	else
+	{
+		// Some parameter is missing. Display an error message.
+		wxPrintf(wxT("You must specify input and output files. Use -h argument to get help.\n"));
+		return false;
+	}
 
-// Get map size in meters from latitude and longitude
-wxSize OSM2MobSinkApp::GetMapSize(float lat_a, float lon_a, float lat_b, float lon_b)
-{
-	float lat_avg = (lat_a + lat_b) / 2;
-	float lat_delta = fabsf(lat_b - lat_a);
-	float lon_delta = fabsf(lon_b - lon_a);
-	float lat_rad = lat_avg * (M_PI / 180);
-	float width = cosf(fabsf(lat_rad)) * lon_delta * 111320;
-	float height = lat_delta * 110574;
-	return wxSize(width, height);
+	return true;
 }
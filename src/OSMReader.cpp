@@ -0,0 +1,691 @@
+/*
+ * OpenStreetMap XML streaming reader implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <OSMReader.h>
+#include <ThreadPool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <charconv>
+#include <deque>
+
+using namespace std;
+
+// XML white space
+static inline bool IsSpace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+// Find str inside data[from, size) and return its position (or size if not found)
+static size_t FindString(const char *data, size_t from, size_t size, const char *str)
+{
+	size_t len = strlen(str);
+	while (from + len <= size)
+	{
+		const char *p = (const char *)memchr(data + from, str[0], size - from - len + 1);
+		if (!p)
+			break;
+
+		if (memcmp(p, str, len) == 0)
+			return p - data;
+
+		from = p - data + 1;
+	}
+
+	return size;
+}
+
+// Append an Unicode code point to a string as UTF-8
+static void AppendUTF8(string &out, unsigned long c)
+{
+	if (c < 0x80)
+	{
+		out += (char)c;
+	}
+	else if (c < 0x800)
+	{
+		out += (char)(0xC0 | (c >> 6));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000)
+	{
+		out += (char)(0xE0 | (c >> 12));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		out += (char)(0xF0 | (c >> 18));
+		out += (char)(0x80 | ((c >> 12) & 0x3F));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+// Decode the entities of an attribute value and normalize its white space.
+// The value is returned where it is if there is nothing to decode, or
+// else it is decoded into out.
+string_view OSMReader::DecodeValue(const char *data, size_t size, string &out)
+{
+	// Most values have nothing to decode, so they are used where they are
+	if (!memchr(data, '&', size) && !memchr(data, '\t', size) && !memchr(data, '\n', size) && !memchr(data, '\r', size))
+		return string_view(data, size);
+
+	out.clear();
+
+	for (size_t i = 0; i < size; i++)
+	{
+		char c = data[i];
+
+		if (c == '&')
+		{
+			const char *end = (const char *)memchr(data + i, ';', size - i);
+			if (end)
+			{
+				string entity(data + i + 1, end - (data + i + 1));
+				bool known = true;
+
+				if (entity == "amp")
+					out += '&';
+				else if (entity == "lt")
+					out += '<';
+				else if (entity == "gt")
+					out += '>';
+				else if (entity == "quot")
+					out += '"';
+				else if (entity == "apos")
+					out += '\'';
+				else if ((entity.size() > 2) && (entity[0] == '#') && (entity[1] == 'x'))
+					AppendUTF8(out, strtoul(entity.c_str() + 2, NULL, 16));
+				else if ((entity.size() > 1) && (entity[0] == '#'))
+					AppendUTF8(out, strtoul(entity.c_str() + 1, NULL, 10));
+				else
+					known = false;
+
+				if (known)
+				{
+					i = end - data;
+					continue;
+				}
+			}
+		}
+		// Line breaks and tabs are normalized to spaces (CR LF counts as one)
+		else if ((c == '\r') && (i + 1 < size) && (data[i + 1] == '\n'))
+		{
+			continue;
+		}
+		else if ((c == '\t') || (c == '\n') || (c == '\r'))
+		{
+			c = ' ';
+		}
+
+		out += c;
+	}
+
+	return out;
+}
+
+// Read a number from an attribute value (0 if there is no value)
+template <typename T>
+static T ParseNumber(const string_view *value)
+{
+	T number = 0;
+	if (!value)
+		return number;
+
+	const char *begin = value->data(), *end = value->data() + value->size();
+	while ((begin < end) && (IsSpace(*begin) || (*begin == '+')))
+		begin++;
+
+	from_chars(begin, end, number);
+	return number;
+}
+
+// Is there an element that may start a chunk at this line?
+static bool IsChunkStart(const char *data, size_t pos, size_t size)
+{
+	while ((pos < size) && ((data[pos] == ' ') || (data[pos] == '\t')))
+		pos++;
+
+	const char *names[] = { "<node", "<way", "<relation" };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		size_t len = strlen(names[i]);
+		if ((pos + len < size) && (memcmp(data + pos, names[i], len) == 0) && (IsSpace(data[pos + len]) || (data[pos + len] == '>') || (data[pos + len] == '/')))
+			return true;
+	}
+
+	return false;
+}
+
+// Return the position of the first line after from (and before size) where
+// a chunk may start, or size if there is none
+static size_t FindChunkStart(const char *data, size_t from, size_t size)
+{
+	while (from < size)
+	{
+		const char *nl = (const char *)memchr(data + from, '\n', size - from);
+		if (!nl)
+			break;
+
+		from = nl - data + 1;
+		if (IsChunkStart(data, from, size))
+			return from;
+	}
+
+	return size;
+}
+
+// Return the position of the last line where a chunk may start, or 0 if there is none
+static size_t FindLastChunkStart(const char *data, size_t size)
+{
+	for (size_t pos = size; pos > 1; pos--)
+	{
+		if ((data[pos - 1] == '\n') && IsChunkStart(data, pos, size))
+			return pos;
+	}
+
+	return 0;
+}
+
+// Collects the elements of a chunk into a block
+class OSMBlockHandler: public OSMHandler
+{
+public:
+	OSMBlockHandler(osm_block &block): block(block) {}
+
+	virtual void OnBounds(const osm_bounds &bounds)
+	{
+		block.bounds.push_back(bounds);
+		block.order.push_back(OSM_BOUNDS);
+	}
+
+	virtual void OnNode(const osm_node &node)
+	{
+		block.nodes.push_back(node);
+		block.order.push_back(OSM_NODE);
+	}
+
+	virtual void OnWay(const osm_way &way)
+	{
+		block.ways.push_back(way);
+		block.order.push_back(OSM_WAY);
+	}
+
+private:
+	osm_block &block;
+};
+
+// Parse a chunk of a document into a block
+static void ParseChunk(shared_ptr<string> data, size_t offset, size_t size, bool first, bool last, osm_block *block)
+{
+	OSMBlockHandler handler(*block);
+	OSMReader reader(&handler);
+	block->ok = reader.ParseFragment(data->data() + offset, size, first, last);
+}
+
+// Constructor
+OSMReader::OSMReader(OSMHandler *handler, unsigned int threads)
+{
+	this->handler = handler;
+	this->threads = threads;
+	Reset();
+}
+
+// Report the elements of a block to a handler, in document order
+void OSMReader::Dispatch(const osm_block &block, OSMHandler *handler)
+{
+	size_t bounds = 0, nodes = 0, ways = 0;
+
+	for (size_t i = 0; i < block.order.size(); i++)
+	{
+		switch (block.order[i])
+		{
+		case OSM_BOUNDS:
+			handler->OnBounds(block.bounds[bounds++]);
+			break;
+
+		case OSM_NODE:
+			handler->OnNode(block.nodes[nodes++]);
+			break;
+
+		case OSM_WAY:
+			handler->OnWay(block.ways[ways++]);
+			break;
+		}
+	}
+}
+
+// Reset the parser state
+void OSMReader::Reset(void)
+{
+	this->ok = true;
+	this->root = false;
+	this->level = 1;
+	this->stack.clear();
+	this->nattrs = 0;
+	this->in_way = false;
+}
+
+// Read the whole file, one block at a time
+bool OSMReader::Parse(FILE *fp)
+{
+	FileStream input(fp);
+	return Parse(input);
+}
+
+// Read the whole stream, one block at a time
+bool OSMReader::Parse(InputStream &input)
+{
+	if (this->threads > 1)
+		return ParseChunks(input);
+
+	vector<char> buffer(OSMREADER_BLOCK_SIZE);
+	size_t length = 0;
+	bool last = false;
+
+	Reset();
+
+	while (this->ok && !last)
+	{
+		// An element larger than the buffer? Make room for it.
+		if (length == buffer.size())
+			buffer.resize(buffer.size() * 2);
+
+		length += input.Read(&buffer[length], buffer.size() - length);
+		last = input.IsEnd();
+
+		// Keep the incomplete markup at the end of the block for the next round
+		size_t used = ParseBlock(&buffer[0], length, last);
+		memmove(&buffer[0], &buffer[used], length - used);
+		length -= used;
+	}
+
+	if (input.IsError())
+		this->ok = false;
+
+	return this->ok && this->root && this->stack.empty();
+}
+
+// Read a document that is already in memory
+bool OSMReader::Parse(const char *data, size_t size)
+{
+	Reset();
+	ParseBlock(data, size, true);
+	return this->ok && this->root && this->stack.empty();
+}
+
+// Parse a part of a document. The first part must have the XML prolog and
+// the <osm> start tag, and only the last one may close it.
+bool OSMReader::ParseFragment(const char *data, size_t size, bool first, bool last)
+{
+	Reset();
+
+	if (!first)
+	{
+		this->root = true;
+		this->stack.push_back("osm");
+	}
+
+	ParseBlock(data, size, true);
+	return this->ok && this->root && (this->stack.size() == (last ? 0 : 1));
+}
+
+// Read the whole stream in chunks parsed by a pool of threads
+bool OSMReader::ParseChunks(InputStream &input)
+{
+	ThreadPool pool(this->threads);
+	deque<pair<shared_ptr<osm_block>, future<void> > > pending;
+	size_t window = pool.GetSize() * 2;
+	size_t segment_size = (size_t)OSMREADER_CHUNK_SIZE * pool.GetSize();
+	string tail;
+	bool first = true, last = false;
+
+	Reset();
+
+	while (this->ok && !last)
+	{
+		// Read a segment of the file after what was left from the previous one
+		shared_ptr<string> segment(new string(tail));
+		size_t length = segment->size();
+		segment->resize(length + segment_size);
+		length += input.Read(&(*segment)[length], segment_size);
+		segment->resize(length);
+		last = input.IsEnd();
+
+		// Only split up to the last place where a chunk may start
+		size_t end = last ? length : FindLastChunkStart(segment->data(), length);
+
+		for (size_t start = 0; start < end; )
+		{
+			size_t stop = end;
+			if (end - start > OSMREADER_CHUNK_SIZE)
+				stop = FindChunkStart(segment->data(), start + OSMREADER_CHUNK_SIZE, end);
+
+			shared_ptr<osm_block> block(new osm_block);
+			pending.push_back(make_pair(block, pool.Async<void>(bind(ParseChunk, segment, start, stop - start, first, last && (stop == end), block.get()))));
+			first = false;
+			start = stop;
+
+			// Keep a limited number of chunks in memory, handling the oldest first
+			while (pending.size() > window)
+			{
+				pending.front().second.wait();
+				if (this->ok && pending.front().first->ok)
+					Dispatch(*pending.front().first, this->handler);
+				else
+					this->ok = false;
+				pending.pop_front();
+			}
+		}
+
+		tail.assign(segment->data() + end, length - end);
+	}
+
+	// Handle the remaining chunks
+	while (!pending.empty())
+	{
+		pending.front().second.wait();
+		if (this->ok && pending.front().first->ok)
+			Dispatch(*pending.front().first, this->handler);
+		else
+			this->ok = false;
+		pending.pop_front();
+	}
+
+	if (input.IsError())
+		this->ok = false;
+
+	// An empty file never gets to the last chunk
+	return this->ok && !first;
+}
+
+// Parse all the complete markup in a block and return how many bytes were used.
+// If last is false, an incomplete markup at the end is left for the next block.
+size_t OSMReader::ParseBlock(const char *data, size_t size, bool last)
+{
+	size_t pos = 0;
+
+	while (this->ok && (pos < size))
+	{
+		// Skip the text until the next markup
+		const char *lt = (const char *)memchr(data + pos, '<', size - pos);
+		if (!lt)
+			return size;
+
+		size_t start = lt - data;
+		size_t end = size;
+
+		// Make sure there is enough data to tell which kind of markup this is
+		if (!last && (size - start < 16))
+			return start;
+
+		// Comments, processing instructions, CDATA and declarations
+		if (FindString(data, start, start + 4 < size ? start + 4 : size, "<!--") == start)
+		{
+			end = FindString(data, start + 4, size, "-->");
+			end = end < size ? end + 2 : size;
+		}
+		else if ((start + 1 < size) && (data[start + 1] == '?'))
+		{
+			end = FindString(data, start + 2, size, "?>");
+			end = end < size ? end + 1 : size;
+		}
+		else if (FindString(data, start, start + 9 < size ? start + 9 : size, "<![CDATA[") == start)
+		{
+			end = FindString(data, start + 9, size, "]]>");
+			end = end < size ? end + 2 : size;
+		}
+		else if ((start + 1 < size) && (data[start + 1] == '!'))
+		{
+			const char *gt = (const char *)memchr(data + start, '>', size - start);
+			end = gt ? gt - data : size;
+		}
+		// Elements ('>' may appear inside quoted attribute values)
+		else
+		{
+			char quote = 0;
+			for (end = start + 1; end < size; end++)
+			{
+				char c = data[end];
+				if (quote)
+				{
+					if (c == quote)
+						quote = 0;
+				}
+				else if ((c == '"') || (c == '\''))
+				{
+					quote = c;
+				}
+				else if (c == '>')
+				{
+					break;
+				}
+			}
+
+			if (end < size)
+				ParseElement(data + start + 1, end - start - 1);
+		}
+
+		// Incomplete markup
+		if (end >= size)
+		{
+			if (!last)
+				return start;
+
+			this->ok = false;
+			return size;
+		}
+
+		pos = end + 1;
+	}
+
+	return pos;
+}
+
+// Parse the contents of an element tag (between '<' and '>')
+void OSMReader::ParseElement(const char *data, size_t size)
+{
+	size_t i = 0;
+
+	// End tag
+	if ((size > 0) && (data[0] == '/'))
+	{
+		for (i = 1; (i < size) && !IsSpace(data[i]); i++);
+		this->element.assign(data + 1, i - 1);
+		EndElement(this->element);
+		return;
+	}
+
+	// Empty element tag
+	bool empty = (size > 0) && (data[size - 1] == '/');
+	if (empty)
+		size--;
+
+	// Element name
+	for (i = 0; (i < size) && !IsSpace(data[i]); i++);
+	if (i == 0)
+	{
+		this->ok = false;
+		return;
+	}
+	this->element.assign(data, i);
+
+	// Attributes
+	this->nattrs = 0;
+	while (true)
+	{
+		while ((i < size) && IsSpace(data[i]))
+			i++;
+
+		if (i >= size)
+			break;
+
+		size_t name = i;
+		while ((i < size) && (data[i] != '=') && !IsSpace(data[i]))
+			i++;
+		size_t name_end = i;
+
+		while ((i < size) && IsSpace(data[i]))
+			i++;
+
+		if ((i >= size) || (data[i] != '='))
+		{
+			this->ok = false;
+			return;
+		}
+		i++;
+
+		while ((i < size) && IsSpace(data[i]))
+			i++;
+
+		if ((i >= size) || ((data[i] != '"') && (data[i] != '\'')))
+		{
+			this->ok = false;
+			return;
+		}
+
+		const char *value_end = (const char *)memchr(data + i + 1, data[i], size - i - 1);
+		if (!value_end)
+		{
+			this->ok = false;
+			return;
+		}
+
+		if (this->nattrs == this->attrs.size())
+			this->attrs.resize(this->nattrs + 1);
+
+		xml_attribute &attr = this->attrs[this->nattrs++];
+		attr.name = string_view(data + name, name_end - name);
+		attr.value = DecodeValue(data + i + 1, value_end - (data + i + 1), attr.decoded);
+		i = value_end - data + 1;
+	}
+
+	StartElement(this->element, empty);
+}
+
+// An element has started
+void OSMReader::StartElement(const string &name, bool empty)
+{
+	// The document must have a single <osm> (or <osmChange>) root
+	if (!this->root)
+	{
+		if (name == "osmChange")
+			this->level = 2;
+		else if (name != "osm")
+		{
+			this->ok = false;
+			return;
+		}
+		this->root = true;
+	}
+	else if (this->stack.empty())
+	{
+		this->ok = false;
+		return;
+	}
+
+	// Change actions
+	if ((this->level == 2) && (this->stack.size() == 1))
+	{
+		if (name == "create")
+			this->handler->OnAction(OSM_CREATE);
+		else if (name == "modify")
+			this->handler->OnAction(OSM_MODIFY);
+		else if (name == "delete")
+			this->handler->OnAction(OSM_DELETE);
+	}
+	// Boundaries
+	else if ((this->stack.size() == this->level) && (name == "bounds"))
+	{
+		osm_bounds bounds;
+		bounds.minlat = ParseNumber<double>(GetAttribute("minlat"));
+		bounds.maxlat = ParseNumber<double>(GetAttribute("maxlat"));
+		bounds.minlon = ParseNumber<double>(GetAttribute("minlon"));
+		bounds.maxlon = ParseNumber<double>(GetAttribute("maxlon"));
+		this->handler->OnBounds(bounds);
+	}
+	// Nodes
+	else if ((this->stack.size() == this->level) && (name == "node"))
+	{
+		osm_node node;
+		node.id = ParseNumber<int64_t>(GetAttribute("id"));
+		node.lat = ParseNumber<double>(GetAttribute("lat"));
+		node.lon = ParseNumber<double>(GetAttribute("lon"));
+		this->handler->OnNode(node);
+	}
+	// Ways (reported when they end)
+	else if ((this->stack.size() == this->level) && (name == "way"))
+	{
+		this->way.id = ParseNumber<int64_t>(GetAttribute("id"));
+		this->way.refs.clear();
+		this->way.tags.clear();
+		this->in_way = true;
+	}
+	// Way nodes
+	else if (this->in_way && (this->stack.size() == this->level + 1) && (name == "nd"))
+	{
+		this->way.refs.push_back(ParseNumber<int64_t>(GetAttribute("ref")));
+	}
+	// Way tags
+	else if (this->in_way && (this->stack.size() == this->level + 1) && (name == "tag"))
+	{
+		const string_view *k = GetAttribute("k");
+		const string_view *v = GetAttribute("v");
+
+		this->way.tags.emplace_back();
+		osm_tag &tag = this->way.tags.back();
+		tag.key.assign(k ? k->data() : "", k ? k->size() : 0);
+		tag.value.assign(v ? v->data() : "", v ? v->size() : 0);
+	}
+
+	// An empty element ends right away
+	this->stack.push_back(name);
+	if (empty)
+		EndElement(name);
+}
+
+// An element has ended
+void OSMReader::EndElement(const string &name)
+{
+	if (this->stack.empty() || (this->stack.back() != name))
+	{
+		this->ok = false;
+		return;
+	}
+
+	this->stack.pop_back();
+
+	if (this->in_way && (this->stack.size() == this->level) && (name == "way"))
+	{
+		this->handler->OnWay(this->way);
+		this->in_way = false;
+	}
+}
+
+// Return the value of an attribute of the current element (or NULL if it was not set)
+const string_view *OSMReader::GetAttribute(const char *name)
+{
+	for (size_t i = 0; i < this->nattrs; i++)
+	{
+		if (this->attrs[i].name == name)
+			return &this->attrs[i].value;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,577 @@
+/*
+ * OpenStreetMap PBF reader implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <PBFReader.h>
+#include <ThreadPool.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+#include <deque>
+
+using namespace std;
+
+// Protocol Buffers wire types
+enum pbf_wiretype
+{
+	PBF_VARINT = 0,
+	PBF_FIXED64 = 1,
+	PBF_LENGTH = 2,
+	PBF_FIXED32 = 5,
+};
+
+// A field read from a Protocol Buffers message
+struct pbf_field
+{
+	unsigned int number;
+	unsigned int type;
+	uint64_t value;         // Value of varint and fixed fields, size of length delimited ones
+	const uint8_t *data;    // Contents of length delimited fields
+};
+
+// Read a varint and move p after it
+static bool ReadVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+{
+	value = 0;
+	for (unsigned int shift = 0; (p < end) && (shift < 64); shift += 7)
+	{
+		uint8_t byte = *p++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+// Read the next field of a message and move p after it
+static bool ReadField(const uint8_t *&p, const uint8_t *end, pbf_field &field)
+{
+	uint64_t key;
+	if (!ReadVarint(p, end, key))
+		return false;
+
+	field.number = key >> 3;
+	field.type = key & 7;
+	field.data = NULL;
+
+	switch (field.type)
+	{
+	case PBF_VARINT:
+		return ReadVarint(p, end, field.value);
+
+	case PBF_FIXED64:
+	case PBF_FIXED32:
+	{
+		unsigned int size = field.type == PBF_FIXED64 ? 8 : 4;
+		if ((size_t)(end - p) < size)
+			return false;
+
+		field.value = 0;
+		for (unsigned int i = 0; i < size; i++)
+			field.value |= (uint64_t)p[i] << (8 * i);
+		p += size;
+		return true;
+	}
+
+	case PBF_LENGTH:
+		if (!ReadVarint(p, end, field.value) || (field.value > (uint64_t)(end - p)))
+			return false;
+
+		field.data = p;
+		p += field.value;
+		return true;
+	}
+
+	return false;
+}
+
+// Decode a zigzag encoded signed integer
+static inline int64_t ZigZag(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Get the uncompressed contents of a Blob message
+static bool Unpack(const string &blob, string &data)
+{
+	const uint8_t *p = (const uint8_t *)blob.data();
+	const uint8_t *end = p + blob.size();
+	const uint8_t *zdata = NULL;
+	uint64_t zsize = 0, raw_size = 0;
+	bool raw = false;
+	pbf_field field;
+
+	while (p < end)
+	{
+		if (!ReadField(p, end, field))
+			return false;
+
+		if ((field.number == 1) && (field.type == PBF_LENGTH))
+		{
+			data.assign((const char *)field.data, field.value);
+			raw = true;
+		}
+		else if ((field.number == 2) && (field.type == PBF_VARINT))
+		{
+			raw_size = field.value;
+		}
+		else if ((field.number == 3) && (field.type == PBF_LENGTH))
+		{
+			zdata = field.data;
+			zsize = field.value;
+		}
+	}
+
+	if (raw)
+		return true;
+
+	// Only zlib compression is supported
+	if (!zdata || (raw_size == 0) || (raw_size > PBF_MAX_BLOB_SIZE))
+		return false;
+
+	data.resize(raw_size);
+	uLongf size = raw_size;
+	if (uncompress((Bytef *)&data[0], &size, zdata, zsize) != Z_OK)
+		return false;
+
+	return size == raw_size;
+}
+
+// Constructor (0 threads means one per CPU core)
+PBFReader::PBFReader(OSMHandler *handler, unsigned int threads)
+{
+	this->handler = handler;
+	this->threads = threads;
+}
+
+// Read the whole file
+bool PBFReader::Parse(FILE *fp)
+{
+	FileStream input(fp);
+	return Parse(input);
+}
+
+// Read the whole stream
+bool PBFReader::Parse(InputStream &input)
+{
+	ThreadPool pool(this->threads);
+	deque<pair<shared_ptr<osm_block>, future<void> > > pending;
+	size_t window = pool.GetSize() * 4;
+	bool ok = true, header = false;
+	string blobheader;
+
+	while (ok)
+	{
+		// Each blob is preceded by its header and the header size (big endian)
+		uint8_t size[4];
+		size_t n = input.Read(size, 4);
+		if ((n == 0) && input.IsEnd())
+			break;
+
+		uint32_t header_size = ((uint32_t)size[0] << 24) | ((uint32_t)size[1] << 16) | ((uint32_t)size[2] << 8) | size[3];
+		if ((n != 4) || (header_size > PBF_MAX_HEADER_SIZE))
+		{
+			ok = false;
+			break;
+		}
+
+		blobheader.resize(header_size);
+		if (input.Read(&blobheader[0], header_size) != header_size)
+		{
+			ok = false;
+			break;
+		}
+
+		// BlobHeader: the blob type and size
+		const uint8_t *p = (const uint8_t *)blobheader.data();
+		const uint8_t *end = p + blobheader.size();
+		string type;
+		uint64_t datasize = 0;
+		pbf_field field;
+
+		while (ok && (p < end))
+		{
+			if (!ReadField(p, end, field))
+				ok = false;
+			else if ((field.number == 1) && (field.type == PBF_LENGTH))
+				type.assign((const char *)field.data, field.value);
+			else if ((field.number == 3) && (field.type == PBF_VARINT))
+				datasize = field.value;
+		}
+
+		if (!ok || (datasize > PBF_MAX_BLOB_SIZE))
+		{
+			ok = false;
+			break;
+		}
+
+		shared_ptr<string> blob(new string(datasize, 0));
+		if (input.Read(&(*blob)[0], datasize) != datasize)
+		{
+			ok = false;
+			break;
+		}
+
+		// The header comes first and holds the boundaries
+		if (type == "OSMHeader")
+		{
+			osm_bounds bounds;
+			bool has_bounds = false;
+
+			if (header || !DecodeHeader(*blob, bounds, has_bounds))
+				ok = false;
+			else if (has_bounds)
+				this->handler->OnBounds(bounds);
+
+			header = true;
+		}
+		// Data blobs are decoded in the background
+		else if (type == "OSMData")
+		{
+			if (!header)
+			{
+				ok = false;
+				break;
+			}
+
+			shared_ptr<osm_block> block(new osm_block);
+			pending.push_back(make_pair(block, pool.Async<void>([blob, block]() { DecodeBlock(*blob, *block); })));
+
+			// Keep a limited number of blobs in memory, handling the oldest first
+			while (pending.size() > window)
+			{
+				pending.front().second.wait();
+				if (pending.front().first->ok)
+					OSMReader::Dispatch(*pending.front().first, this->handler);
+				else
+					ok = false;
+				pending.pop_front();
+			}
+		}
+		// Unknown blob types must be skipped
+	}
+
+	// Handle the remaining blobs
+	while (!pending.empty())
+	{
+		pending.front().second.wait();
+		if (ok && pending.front().first->ok)
+			OSMReader::Dispatch(*pending.front().first, this->handler);
+		else
+			ok = false;
+		pending.pop_front();
+	}
+
+	if (input.IsError())
+		ok = false;
+
+	return ok && header;
+}
+
+// Decode an OSMHeader blob
+bool PBFReader::DecodeHeader(const string &blob, osm_bounds &bounds, bool &has_bounds)
+{
+	string data;
+	if (!Unpack(blob, data))
+		return false;
+
+	const uint8_t *p = (const uint8_t *)data.data();
+	const uint8_t *end = p + data.size();
+	pbf_field field;
+
+	has_bounds = false;
+
+	while (p < end)
+	{
+		if (!ReadField(p, end, field))
+			return false;
+
+		// Bounding box (in nanodegrees)
+		if ((field.number == 1) && (field.type == PBF_LENGTH))
+		{
+			const uint8_t *q = field.data;
+			const uint8_t *q_end = q + field.value;
+			pbf_field box;
+
+			while (q < q_end)
+			{
+				if (!ReadField(q, q_end, box))
+					return false;
+
+				if (box.number == 1)
+					bounds.minlon = ZigZag(box.value) / 1e9;
+				else if (box.number == 2)
+					bounds.maxlon = ZigZag(box.value) / 1e9;
+				else if (box.number == 3)
+					bounds.maxlat = ZigZag(box.value) / 1e9;
+				else if (box.number == 4)
+					bounds.minlat = ZigZag(box.value) / 1e9;
+			}
+
+			has_bounds = true;
+		}
+		// Required features we don't know about make the file unreadable
+		else if ((field.number == 4) && (field.type == PBF_LENGTH))
+		{
+			string feature((const char *)field.data, field.value);
+			if ((feature != "OsmSchema-V0.6") && (feature != "DenseNodes"))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Decode an OSMData blob (a PrimitiveBlock)
+void PBFReader::DecodeBlock(const string &blob, osm_block &block)
+{
+	string data;
+	block.ok = Unpack(blob, data);
+	if (!block.ok)
+		return;
+
+	const uint8_t *p = (const uint8_t *)data.data();
+	const uint8_t *end = p + data.size();
+	vector<pair<const char *, size_t> > strings;
+	vector<pbf_field> groups;
+	int64_t granularity = 100, lat_offset = 0, lon_offset = 0;
+	pbf_field field;
+
+	// The string table and the coordinate parameters may come after the groups
+	while (p < end)
+	{
+		if (!ReadField(p, end, field))
+		{
+			block.ok = false;
+			return;
+		}
+
+		if ((field.number == 1) && (field.type == PBF_LENGTH))
+		{
+			const uint8_t *q = field.data;
+			const uint8_t *q_end = q + field.value;
+			pbf_field s;
+
+			while (q < q_end)
+			{
+				if (!ReadField(q, q_end, s))
+				{
+					block.ok = false;
+					return;
+				}
+
+				if (s.number == 1)
+					strings.push_back(make_pair((const char *)s.data, (size_t)s.value));
+			}
+		}
+		else if ((field.number == 2) && (field.type == PBF_LENGTH))
+		{
+			groups.push_back(field);
+		}
+		else if (field.number == 17)
+		{
+			granularity = field.value;
+		}
+		else if (field.number == 19)
+		{
+			lat_offset = field.value;
+		}
+		else if (field.number == 20)
+		{
+			lon_offset = field.value;
+		}
+	}
+
+	// Coordinates are divided (not multiplied by 1e-9) so that they match the
+	// values read from the decimal degrees of the XML format
+	for (unsigned int g = 0; block.ok && (g < groups.size()); g++)
+	{
+		const uint8_t *q = groups[g].data;
+		const uint8_t *q_end = q + groups[g].value;
+		pbf_field item;
+
+		while (block.ok && (q < q_end))
+		{
+			if (!ReadField(q, q_end, item))
+			{
+				block.ok = false;
+				break;
+			}
+
+			if (item.type != PBF_LENGTH)
+				continue;
+
+			const uint8_t *r = item.data;
+			const uint8_t *r_end = r + item.value;
+			pbf_field f;
+
+			// Nodes
+			if (item.number == 1)
+			{
+				int64_t id = 0, lat = 0, lon = 0;
+
+				while (r < r_end)
+				{
+					if (!ReadField(r, r_end, f))
+					{
+						block.ok = false;
+						break;
+					}
+
+					if (f.number == 1)
+						id = ZigZag(f.value);
+					else if (f.number == 8)
+						lat = ZigZag(f.value);
+					else if (f.number == 9)
+						lon = ZigZag(f.value);
+				}
+
+				osm_node node;
+				node.id = id;
+				node.lat = (lat_offset + granularity * lat) / 1e9;
+				node.lon = (lon_offset + granularity * lon) / 1e9;
+				block.nodes.push_back(node);
+				block.order.push_back(OSM_NODE);
+			}
+			// Dense nodes (delta coded arrays)
+			else if (item.number == 2)
+			{
+				const uint8_t *ids = NULL, *ids_end = NULL;
+				const uint8_t *lats = NULL, *lats_end = NULL;
+				const uint8_t *lons = NULL, *lons_end = NULL;
+
+				while (r < r_end)
+				{
+					if (!ReadField(r, r_end, f))
+					{
+						block.ok = false;
+						break;
+					}
+
+					if ((f.number == 1) && (f.type == PBF_LENGTH))
+					{
+						ids = f.data;
+						ids_end = f.data + f.value;
+					}
+					else if ((f.number == 8) && (f.type == PBF_LENGTH))
+					{
+						lats = f.data;
+						lats_end = f.data + f.value;
+					}
+					else if ((f.number == 9) && (f.type == PBF_LENGTH))
+					{
+						lons = f.data;
+						lons_end = f.data + f.value;
+					}
+				}
+
+				int64_t id = 0, lat = 0, lon = 0;
+				while (block.ok && (ids < ids_end))
+				{
+					uint64_t d_id, d_lat, d_lon;
+					if (!ReadVarint(ids, ids_end, d_id) || !ReadVarint(lats, lats_end, d_lat) || !ReadVarint(lons, lons_end, d_lon))
+					{
+						block.ok = false;
+						break;
+					}
+
+					id += ZigZag(d_id);
+					lat += ZigZag(d_lat);
+					lon += ZigZag(d_lon);
+
+					osm_node node;
+					node.id = id;
+					node.lat = (lat_offset + granularity * lat) / 1e9;
+					node.lon = (lon_offset + granularity * lon) / 1e9;
+					block.nodes.push_back(node);
+					block.order.push_back(OSM_NODE);
+				}
+			}
+			// Ways
+			else if (item.number == 3)
+			{
+				const uint8_t *keys = NULL, *keys_end = NULL;
+				const uint8_t *vals = NULL, *vals_end = NULL;
+				const uint8_t *refs = NULL, *refs_end = NULL;
+				osm_way way;
+				way.id = 0;
+
+				while (r < r_end)
+				{
+					if (!ReadField(r, r_end, f))
+					{
+						block.ok = false;
+						break;
+					}
+
+					if ((f.number == 1) && (f.type == PBF_VARINT))
+					{
+						way.id = f.value;
+					}
+					else if ((f.number == 2) && (f.type == PBF_LENGTH))
+					{
+						keys = f.data;
+						keys_end = f.data + f.value;
+					}
+					else if ((f.number == 3) && (f.type == PBF_LENGTH))
+					{
+						vals = f.data;
+						vals_end = f.data + f.value;
+					}
+					else if ((f.number == 8) && (f.type == PBF_LENGTH))
+					{
+						refs = f.data;
+						refs_end = f.data + f.value;
+					}
+				}
+
+				int64_t ref = 0;
+				while (block.ok && (refs < refs_end))
+				{
+					uint64_t delta;
+					if (!ReadVarint(refs, refs_end, delta))
+					{
+						block.ok = false;
+						break;
+					}
+
+					ref += ZigZag(delta);
+					way.refs.push_back(ref);
+				}
+
+				while (block.ok && (keys < keys_end))
+				{
+					uint64_t k, v;
+					if (!ReadVarint(keys, keys_end, k) || !ReadVarint(vals, vals_end, v) || (k >= strings.size()) || (v >= strings.size()))
+					{
+						block.ok = false;
+						break;
+					}
+
+					osm_tag tag;
+					tag.key.assign(strings[k].first, strings[k].second);
+					tag.value.assign(strings[v].first, strings[v].second);
+					way.tags.push_back(tag);
+				}
+
+				block.ways.push_back(way);
+				block.order.push_back(OSM_WAY);
+			}
+		}
+	}
+}
@@ -0,0 +1,156 @@
+/*
+ * Parse cache.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ParseCache.h>
+#include <BinaryIO.h>
+#include <NodeSet.h>
+#include <string.h>
+
+using namespace std;
+
+// Size of the blocks hashed at a time
+#define PARSECACHE_BLOCK_SIZE (1 << 20)
+
+// Constructor
+ParseCache::ParseCache()
+{
+	this->key = 0;
+	memset(&this->bounds, 0, sizeof(this->bounds));
+}
+
+// Save the cache with the nodes of an index used by the highways
+bool ParseCache::Save(FILE *fp, NodeIndex &nodes)
+{
+	uint32_t version = PARSECACHE_VERSION, order = BINARYIO_BYTE_ORDER;
+
+	bool ok = (fwrite(PARSECACHE_MAGIC, 8, 1, fp) == 1) && BinaryPut(fp, version) && BinaryPut(fp, order) &&
+			BinaryPut(fp, this->key) && BinaryPut(fp, this->bounds);
+
+	// Nodes used by the highways, in id order
+	NodeSet used;
+	for (size_t i = 0; i < this->ways.size(); i++)
+	{
+		for (size_t j = 0; j < this->ways[i].refs.size(); j++)
+			used.Insert(this->ways[i].refs[j]);
+	}
+
+	vector<int64_t> ids;
+	vector<node_location> locations;
+	nodes.ForEach([&](int64_t id, const node_location &location)
+	{
+		if (used.Contains(id))
+		{
+			ids.push_back(id);
+			locations.push_back(location);
+		}
+	});
+
+	ok = ok && BinaryPutArray(fp, ids.data(), ids.size()) && BinaryPutArray(fp, locations.data(), locations.size());
+
+	// Highways
+	uint64_t count = this->ways.size();
+	ok = ok && BinaryPut(fp, count);
+
+	for (size_t i = 0; ok && (i < this->ways.size()); i++)
+	{
+		const cache_way &way = this->ways[i];
+		int32_t flow = way.flow;
+
+		ok = BinaryPut(fp, way.id) && BinaryPut(fp, flow) && BinaryPut(fp, way.speedlimit) &&
+			BinaryPutArray(fp, way.name.data(), way.name.size()) && BinaryPutArray(fp, way.refs.data(), way.refs.size());
+	}
+
+	return ok && (fflush(fp) == 0);
+}
+
+// Load a cache made for the input with the current key, inserting its
+// nodes into an index
+bool ParseCache::Load(FILE *fp, NodeIndex &nodes)
+{
+	char magic[8];
+	uint32_t version, order;
+	uint64_t key;
+
+	if ((fread(magic, 8, 1, fp) != 1) || (memcmp(magic, PARSECACHE_MAGIC, 8) != 0) || !BinaryGet(fp, version) ||
+		!BinaryGet(fp, order) || (version != PARSECACHE_VERSION) || (order != BINARYIO_BYTE_ORDER) ||
+		!BinaryGet(fp, key) || (key != this->key) || !BinaryGet(fp, this->bounds))
+		return false;
+
+	// Nodes
+	vector<int64_t> ids;
+	vector<node_location> locations;
+	if (!BinaryGetArray(fp, ids) || !BinaryGetArray(fp, locations) || (ids.size() != locations.size()))
+		return false;
+
+	for (size_t i = 0; i < ids.size(); i++)
+		nodes.Insert(ids[i], NodeIndex::ToDegrees(locations[i].lat), NodeIndex::ToDegrees(locations[i].lon));
+
+	// Highways
+	uint64_t count;
+	if (!BinaryGet(fp, count) || (count > BINARYIO_MAX_ARRAY / sizeof(cache_way)))
+		return false;
+
+	this->ways.resize(count);
+	for (size_t i = 0; i < this->ways.size(); i++)
+	{
+		cache_way &way = this->ways[i];
+		int32_t flow;
+		vector<char> name;
+
+		if (!BinaryGet(fp, way.id) || !BinaryGet(fp, flow) || !BinaryGet(fp, way.speedlimit) ||
+			!BinaryGetArray(fp, name) || !BinaryGetArray(fp, way.refs))
+			return false;
+
+		way.flow = flow;
+		way.name.assign(name.begin(), name.end());
+	}
+
+	return true;
+}
+
+// Hash the contents of a file (read from the current position to the end).
+// Eight bytes are mixed at a time, so hashing is much faster than parsing.
+uint64_t ParseCache::Hash(FILE *fp)
+{
+	vector<unsigned char> buffer(PARSECACHE_BLOCK_SIZE);
+	uint64_t hash = 0x9e3779b97f4a7c15ULL, total = 0;
+	size_t size;
+
+	while ((size = fread(&buffer[0], 1, buffer.size(), fp)) > 0)
+	{
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, &buffer[i], 8);
+			hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+			hash ^= hash >> 32;
+		}
+
+		for (; i < size; i++)
+			hash = (hash ^ buffer[i]) * 0x100000001b3ULL;
+
+		total += size;
+	}
+
+	// Finish with the size, so trailing zeros count
+	hash ^= total;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
@@ -0,0 +1,407 @@
+/*
+ * PathIndex class implementation.
+ * Copyright (C) 2015-2018 João Paulo Just Peixoto <just1982@gmail.com>.
+ *
+ * This file is part of MobSink.
+ *
+ * MobSink is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MobSink is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MobSink.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PathIndex.h"
+#include <algorithm>
+#include <math.h>
+#include <thread>
+
+// Order of the nearest paths (ties are broken by the path index)
+static bool NearestLess(const path_nearest &a, const path_nearest &b)
+{
+    if (a.distance != b.distance)
+        return a.distance < b.distance;
+
+    return a.path < b.path;
+}
+
+// Constructors
+PathIndex::PathIndex()
+{
+    this->paths = NULL;
+    this->minx = this->miny = 0;
+    this->cellsize = 1;
+    this->columns = this->rows = 0;
+}
+
+PathIndex::PathIndex(vector<Path> &paths, float cellsize)
+{
+    Build(paths, cellsize);
+}
+
+// Index a set of paths. If cellsize is 0, a size that puts about
+// PATHINDEX_PATHS_PER_CELL paths in each cell is used.
+void PathIndex::Build(vector<Path> &paths, float cellsize)
+{
+    this->paths = &paths;
+    this->minx = this->miny = 0;
+    this->columns = this->rows = 0;
+    this->cell_start.clear();
+    this->cell_paths.clear();
+
+    if (paths.empty())
+    {
+        this->cellsize = 1;
+        return;
+    }
+
+    // Bounding box of all paths
+    float maxx, maxy;
+    this->minx = maxx = paths[0].GetPointA().GetX();
+    this->miny = maxy = paths[0].GetPointA().GetY();
+
+    for (unsigned int i = 0; i < paths.size(); i++)
+    {
+        Point a = paths[i].GetPointA();
+        Point b = paths[i].GetPointB();
+        this->minx = min(this->minx, min(a.GetX(), b.GetX()));
+        this->miny = min(this->miny, min(a.GetY(), b.GetY()));
+        maxx = max(maxx, max(a.GetX(), b.GetX()));
+        maxy = max(maxy, max(a.GetY(), b.GetY()));
+    }
+
+    double width = max(maxx - this->minx, 1.0f);
+    double height = max(maxy - this->miny, 1.0f);
+
+    if (cellsize <= 0)
+        cellsize = sqrt(width * height * PATHINDEX_PATHS_PER_CELL / paths.size());
+
+    // Don't let a tiny cell size blow up the grid
+    while ((floor(width / cellsize) + 1) * (floor(height / cellsize) + 1) > 4.0 * paths.size() + 16)
+        cellsize *= 2;
+
+    this->cellsize = cellsize;
+    this->columns = floor(width / cellsize) + 1;
+    this->rows = floor(height / cellsize) + 1;
+
+    // Count the paths of each cell, then fill them
+    this->cell_start.assign(this->columns * this->rows + 1, 0);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (unsigned int i = 0; i < paths.size(); i++)
+        {
+            Point a = paths[i].GetPointA();
+            Point b = paths[i].GetPointB();
+            int ca, ra, cb, rb;
+            GetCells(a.GetX(), a.GetY(), b.GetX(), b.GetY(), ca, ra, cb, rb);
+
+            for (int row = ra; row <= rb; row++)
+            {
+                for (int column = ca; column <= cb; column++)
+                {
+                    if (pass == 0)
+                        this->cell_start[row * this->columns + column + 1]++;
+                    else
+                        this->cell_paths[this->cell_start[row * this->columns + column]++] = i;
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (unsigned int c = 1; c < this->cell_start.size(); c++)
+                this->cell_start[c] += this->cell_start[c - 1];
+
+            this->cell_paths.resize(this->cell_start.back());
+        }
+        else
+        {
+            // Filling moved each start to the next cell's start
+            for (unsigned int c = this->cell_start.size() - 1; c > 0; c--)
+                this->cell_start[c] = this->cell_start[c - 1];
+
+            this->cell_start[0] = 0;
+        }
+    }
+}
+
+// Find the k nearest paths to Point p, nearest first
+void PathIndex::GetNearest(Point p, unsigned int k, vector<path_nearest> &result)
+{
+    query_scratch scratch;
+    scratch.query = 0;
+    GetNearest(p, k, result, scratch);
+}
+
+// Find the k nearest paths of many points at once
+void PathIndex::GetNearest(vector<Point> &points, unsigned int k, vector<vector<path_nearest> > &result, unsigned int threads)
+{
+    result.resize(points.size());
+    threads = max(1u, min(threads, (unsigned int)points.size()));
+
+    vector<thread> workers;
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers.push_back(thread([this, &points, k, &result, t, threads]()
+        {
+            query_scratch scratch;
+            scratch.query = 0;
+
+            for (size_t i = t; i < points.size(); i += threads)
+                GetNearest(points[i], k, result[i], scratch);
+        }));
+    }
+
+    for (unsigned int t = 0; t < workers.size(); t++)
+        workers[t].join();
+}
+
+// Find the paths crossing Path r (b is 0 in the results)
+void PathIndex::GetCrossings(Path r, vector<path_crossing> &result)
+{
+    query_scratch scratch;
+    scratch.query = 0;
+    result.clear();
+    GetCrossings(r, 0, false, result, scratch);
+}
+
+// Find the paths crossing many segments at once (b is the segment index)
+void PathIndex::GetCrossings(vector<Path> &segments, vector<path_crossing> &result, unsigned int threads)
+{
+    threads = max(1u, min(threads, (unsigned int)segments.size()));
+    vector<vector<path_crossing> > partial(threads);
+    vector<thread> workers;
+
+    // Each thread takes a contiguous range, so the results stay in order
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers.push_back(thread([this, &segments, &partial, t, threads]()
+        {
+            query_scratch scratch;
+            scratch.query = 0;
+            size_t first = segments.size() * t / threads;
+            size_t last = segments.size() * (t + 1) / threads;
+
+            for (size_t i = first; i < last; i++)
+                GetCrossings(segments[i], i, false, partial[t], scratch);
+        }));
+    }
+
+    result.clear();
+    for (unsigned int t = 0; t < workers.size(); t++)
+    {
+        workers[t].join();
+        result.insert(result.end(), partial[t].begin(), partial[t].end());
+    }
+}
+
+// Find all pairs of indexed paths that cross each other. Paths that only
+// share an end point (consecutive paths of a road) are not reported.
+void PathIndex::GetAllCrossings(vector<path_crossing> &result, unsigned int threads)
+{
+    result.clear();
+    if (!this->paths)
+        return;
+
+    vector<Path> &paths = *this->paths;
+    threads = max(1u, min(threads, (unsigned int)paths.size()));
+    vector<vector<path_crossing> > partial(threads);
+    vector<thread> workers;
+
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers.push_back(thread([this, &paths, &partial, t, threads]()
+        {
+            query_scratch scratch;
+            scratch.query = 0;
+            size_t first = paths.size() * t / threads;
+            size_t last = paths.size() * (t + 1) / threads;
+
+            for (size_t i = first; i < last; i++)
+                GetCrossings(paths[i], i, true, partial[t], scratch);
+        }));
+    }
+
+    for (unsigned int t = 0; t < workers.size(); t++)
+    {
+        workers[t].join();
+        result.insert(result.end(), partial[t].begin(), partial[t].end());
+    }
+}
+
+// Return the size of the grid cells
+float PathIndex::GetCellSize(void)
+{
+    return this->cellsize;
+}
+
+// Nearest paths query
+void PathIndex::GetNearest(Point p, unsigned int k, vector<path_nearest> &result, query_scratch &scratch)
+{
+    result.clear();
+    if (!this->paths || (this->columns == 0) || (k == 0) || !NextQuery(scratch))
+        return;
+
+    vector<Path> &paths = *this->paths;
+    int cx, cy, unused;
+    GetCells(p.GetX(), p.GetY(), p.GetX(), p.GetY(), cx, cy, unused, unused);
+
+    // Visit the cells in rings around p, keeping the k best in a max-heap
+    for (int r = 0; ; r++)
+    {
+        for (int row = max(cy - r, 0); row <= min(cy + r, this->rows - 1); row++)
+        {
+            bool edge = (row == cy - r) || (row == cy + r);
+            int step = edge ? 1 : max(2 * r, 1);
+
+            for (int column = cx - r; column <= cx + r; column += step)
+            {
+                if ((column < 0) || (column >= this->columns))
+                    continue;
+
+                int cell = row * this->columns + column;
+                for (unsigned int i = this->cell_start[cell]; i < this->cell_start[cell + 1]; i++)
+                {
+                    unsigned int index = this->cell_paths[i];
+                    if (scratch.stamp[index] == scratch.query)
+                        continue;
+
+                    scratch.stamp[index] = scratch.query;
+
+                    path_nearest candidate;
+                    candidate.path = index;
+                    candidate.point = paths[index].GetNearestPoint(p);
+                    candidate.distance = p.Distance(candidate.point);
+
+                    if (result.size() < k)
+                    {
+                        result.push_back(candidate);
+                        push_heap(result.begin(), result.end(), NearestLess);
+                    }
+                    else if (NearestLess(candidate, result.front()))
+                    {
+                        pop_heap(result.begin(), result.end(), NearestLess);
+                        result.back() = candidate;
+                        push_heap(result.begin(), result.end(), NearestLess);
+                    }
+                }
+            }
+        }
+
+        // The whole grid was visited
+        if ((cx - r <= 0) && (cy - r <= 0) && (cx + r >= this->columns - 1) && (cy + r >= this->rows - 1))
+            break;
+
+        // Paths in cells not visited yet are at least this far from p
+        if (result.size() == k)
+        {
+            float left = this->minx + (cx - r) * this->cellsize;
+            float top = this->miny + (cy - r) * this->cellsize;
+            float right = this->minx + (cx + r + 1) * this->cellsize;
+            float bottom = this->miny + (cy + r + 1) * this->cellsize;
+            float bound = min(min(p.GetX() - left, right - p.GetX()), min(p.GetY() - top, bottom - p.GetY()));
+
+            if (result.front().distance <= bound)
+                break;
+        }
+    }
+
+    sort_heap(result.begin(), result.end(), NearestLess);
+}
+
+// Crossing query. If indexed, r is the indexed path id and only the paths
+// after it that don't share an end point with it are reported.
+void PathIndex::GetCrossings(Path r, unsigned int id, bool indexed, vector<path_crossing> &result, query_scratch &scratch)
+{
+    if (!this->paths || (this->columns == 0) || !NextQuery(scratch))
+        return;
+
+    vector<Path> &paths = *this->paths;
+    Point a = r.GetPointA();
+    Point b = r.GetPointB();
+    int ca, ra, cb, rb;
+    GetCells(a.GetX(), a.GetY(), b.GetX(), b.GetY(), ca, ra, cb, rb);
+
+    // Sorted so that the results don't depend on the grid
+    size_t first = result.size();
+
+    for (int row = ra; row <= rb; row++)
+    {
+        for (int column = ca; column <= cb; column++)
+        {
+            int cell = row * this->columns + column;
+            for (unsigned int i = this->cell_start[cell]; i < this->cell_start[cell + 1]; i++)
+            {
+                unsigned int index = this->cell_paths[i];
+                if ((scratch.stamp[index] == scratch.query) || (indexed && (index <= id)))
+                    continue;
+
+                scratch.stamp[index] = scratch.query;
+
+                if (indexed)
+                {
+                    Point c = paths[index].GetPointA();
+                    Point d = paths[index].GetPointB();
+                    if ((a == c) || (a == d) || (b == c) || (b == d))
+                        continue;
+                }
+
+                bool exist;
+                path_crossing crossing;
+                crossing.point = paths[index].GetIntersection(r, exist);
+                if (!exist)
+                    continue;
+
+                crossing.a = indexed ? id : index;
+                crossing.b = indexed ? index : id;
+                result.push_back(crossing);
+            }
+        }
+    }
+
+    sort(result.begin() + first, result.end(), [](const path_crossing &x, const path_crossing &y)
+    {
+        return (x.a != y.a) ? (x.a < y.a) : (x.b < y.b);
+    });
+}
+
+// Get the range of cells covered by a bounding box (clamped to the grid)
+void PathIndex::GetCells(float xa, float ya, float xb, float yb, int &ca, int &ra, int &cb, int &rb)
+{
+    ca = floor((min(xa, xb) - this->minx) / this->cellsize);
+    cb = floor((max(xa, xb) - this->minx) / this->cellsize);
+    ra = floor((min(ya, yb) - this->miny) / this->cellsize);
+    rb = floor((max(ya, yb) - this->miny) / this->cellsize);
+
+    ca = max(0, min(ca, this->columns - 1));
+    cb = max(0, min(cb, this->columns - 1));
+    ra = max(0, min(ra, this->rows - 1));
+    rb = max(0, min(rb, this->rows - 1));
+}
+
+// Start a new query
+bool PathIndex::NextQuery(query_scratch &scratch)
+{
+    if (scratch.stamp.size() != this->paths->size())
+    {
+        scratch.stamp.assign(this->paths->size(), 0);
+        scratch.query = 0;
+    }
+
+    // The stamps must be cleared when the counter wraps around
+    if (++scratch.query == 0)
+    {
+        fill(scratch.stamp.begin(), scratch.stamp.end(), 0);
+        scratch.query = 1;
+    }
+
+    return true;
+}
@@ -0,0 +1,417 @@
+/*
+ * PathStore class implementation.
+ * Copyright (C) 2015-2018 João Paulo Just Peixoto <just1982@gmail.com>.
+ *
+ * This file is part of MobSink.
+ *
+ * MobSink is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MobSink is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MobSink.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PathStore.h"
+#include <float.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The kernels work on four paths at a time with SSE2 (always available on
+ * x86-64) and fall back to the plain loop for the remaining paths and on
+ * other architectures. Points are projected with the parametric form
+ *
+ *   t = ((p - a) . (b - a)) / |b - a|^2
+ *
+ * which gives the same point as Path::GetProjection() without its special
+ * cases. The nearest point clamps t to [0, 1]. A path whose end points
+ * are the same projects to (xa, p.y), just like a vertical path does.
+ */
+
+// Scalar nearest point of one path
+static inline void Nearest(float px, float py, float xa, float ya, float xb, float yb, float &x, float &y, float &d2)
+{
+    float dx = xb - xa;
+    float dy = yb - ya;
+    float len2 = dx * dx + dy * dy;
+    float t = (len2 > 0) ? ((px - xa) * dx + (py - ya) * dy) / len2 : 0;
+
+    t = fminf(fmaxf(t, 0), 1);
+    x = xa + t * dx;
+    y = ya + t * dy;
+    d2 = (px - x) * (px - x) + (py - y) * (py - y);
+}
+
+#ifdef __SSE2__
+// Nearest point of four paths
+static inline void Nearest4(__m128 px, __m128 py, __m128 xa, __m128 ya, __m128 xb, __m128 yb, __m128 &x, __m128 &y, __m128 &d2)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 dx = _mm_sub_ps(xb, xa);
+    __m128 dy = _mm_sub_ps(yb, ya);
+    __m128 len2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    __m128 dot = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(px, xa), dx), _mm_mul_ps(_mm_sub_ps(py, ya), dy));
+    __m128 valid = _mm_cmpgt_ps(len2, zero);
+    __m128 t = _mm_and_ps(_mm_div_ps(dot, _mm_or_ps(len2, _mm_andnot_ps(valid, _mm_set1_ps(1)))), valid);
+
+    t = _mm_min_ps(_mm_max_ps(t, zero), _mm_set1_ps(1));
+    x = _mm_add_ps(xa, _mm_mul_ps(t, dx));
+    y = _mm_add_ps(ya, _mm_mul_ps(t, dy));
+
+    __m128 ex = _mm_sub_ps(px, x);
+    __m128 ey = _mm_sub_ps(py, y);
+    d2 = _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+}
+#endif
+
+// Constructor
+PathStore::PathStore()
+{
+    Clear();
+}
+
+// Append a copy of a Path (with its control parameters). Return its index.
+size_t PathStore::Add(Path &path)
+{
+    size_t i = Add(path.GetPointA().GetX(), path.GetPointA().GetY(), path.GetPointB().GetX(), path.GetPointB().GetY(),
+                   path.GetFlow(), path.GetName());
+
+    // Replace the default row with the path's own table
+    map<int, struct path_control_params> *params = path.GetPathControl();
+    this->control.resize(this->control_start[i]);
+
+    for (map<int, struct path_control_params>::iterator it = params->begin(); it != params->end(); it++)
+    {
+        pathstore_control row;
+        row.time = it->first;
+        row.params = it->second;
+        this->control.push_back(row);
+    }
+
+    this->control_start[i + 1] = this->control.size();
+    return i;
+}
+
+// Append a new path. Like a new Path, it gets the default control
+// parameters at time 0.
+size_t PathStore::Add(float xa, float ya, float xb, float yb, pathflow flow, wxString name)
+{
+    size_t i = this->xa.size();
+
+    this->xa.push_back(xa);
+    this->ya.push_back(ya);
+    this->xb.push_back(xb);
+    this->yb.push_back(yb);
+    this->flow.push_back(flow);
+
+    map<wxString, unsigned int>::iterator it = this->name_ids.find(name);
+    if (it == this->name_ids.end())
+    {
+        it = this->name_ids.insert(pair<wxString, unsigned int>(name, this->names.size())).first;
+        this->names.push_back(name);
+    }
+    this->name.push_back(it->second);
+
+    pathstore_control row;
+    row.time = 0;
+    row.params.speedlimit = 0;
+    row.params.traffic = 1;
+    row.params.blocked = false;
+    this->control.push_back(row);
+    this->control_start.push_back(this->control.size());
+
+    return i;
+}
+
+// Insert control settings at a specific time into the last path added.
+// As in Path::InsertControl(), an existing time is not replaced.
+void PathStore::InsertControl(int time, float speedlimit, float traffic, bool blocked)
+{
+    if (this->xa.empty())
+        return;
+
+    size_t first = this->control_start[this->xa.size() - 1];
+    size_t pos = first;
+
+    while ((pos < this->control.size()) && (this->control[pos].time < time))
+        pos++;
+
+    if ((pos < this->control.size()) && (this->control[pos].time == time))
+        return;
+
+    pathstore_control row;
+    row.time = time;
+    row.params.speedlimit = speedlimit;
+    row.params.traffic = traffic;
+    row.params.blocked = blocked;
+    this->control.insert(this->control.begin() + pos, row);
+    this->control_start.back()++;
+}
+
+// Reserve room for a number of paths
+void PathStore::Reserve(size_t size)
+{
+    this->xa.reserve(size);
+    this->ya.reserve(size);
+    this->xb.reserve(size);
+    this->yb.reserve(size);
+    this->flow.reserve(size);
+    this->name.reserve(size);
+    this->control_start.reserve(size + 1);
+    this->control.reserve(size);
+}
+
+// Remove all paths
+void PathStore::Clear(void)
+{
+    this->xa.clear();
+    this->ya.clear();
+    this->xb.clear();
+    this->yb.clear();
+    this->flow.clear();
+    this->name.clear();
+    this->names.assign(1, wxEmptyString);
+    this->name_ids.clear();
+    this->name_ids.insert(pair<wxString, unsigned int>(wxEmptyString, 0));
+    this->control_start.assign(1, 0);
+    this->control.clear();
+}
+
+// Getters
+size_t PathStore::GetSize(void)
+{
+    return this->xa.size();
+}
+
+// Build a Path object from path i
+Path PathStore::GetPath(size_t i)
+{
+    Path path(this->xa[i], this->ya[i], this->xb[i], this->yb[i], GetFlow(i));
+    path.SetName(GetName(this->name[i]));
+
+    for (size_t c = this->control_start[i]; c < this->control_start[i + 1]; c++)
+    {
+        struct path_control_params &params = this->control[c].params;
+        path.GetPathControl()->erase(this->control[c].time);
+        path.InsertControl(this->control[c].time, params.speedlimit, params.traffic, params.blocked);
+    }
+
+    return path;
+}
+
+pathflow PathStore::GetFlow(size_t i)
+{
+    return (pathflow)this->flow[i];
+}
+
+unsigned int PathStore::GetNameId(size_t i)
+{
+    return this->name[i];
+}
+
+wxString PathStore::GetName(unsigned int id)
+{
+    return this->names[id];
+}
+
+// Return the number of control rows of path i (at least 1)
+size_t PathStore::GetControlCount(size_t i)
+{
+    return this->control_start[i + 1] - this->control_start[i];
+}
+
+// Return the control rows of path i, sorted by time
+const pathstore_control *PathStore::GetControl(size_t i)
+{
+    return &this->control[this->control_start[i]];
+}
+
+const float *PathStore::GetXA(void)
+{
+    return this->xa.data();
+}
+
+const float *PathStore::GetYA(void)
+{
+    return this->ya.data();
+}
+
+const float *PathStore::GetXB(void)
+{
+    return this->xb.data();
+}
+
+const float *PathStore::GetYB(void)
+{
+    return this->yb.data();
+}
+
+// Lenght of every path
+void PathStore::GetLenghts(float *lenght)
+{
+    size_t n = GetSize(), i = 0;
+
+#ifdef __SSE2__
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&this->xb[i]), _mm_loadu_ps(&this->xa[i]));
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&this->yb[i]), _mm_loadu_ps(&this->ya[i]));
+        _mm_storeu_ps(&lenght[i], _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        float dx = this->xb[i] - this->xa[i];
+        float dy = this->yb[i] - this->ya[i];
+        lenght[i] = sqrtf(dx * dx + dy * dy);
+    }
+}
+
+// Projection of Point p on the line of every path
+void PathStore::GetProjections(Point p, float *x, float *y)
+{
+    size_t n = GetSize(), i = 0;
+    float px = p.GetX(), py = p.GetY();
+
+#ifdef __SSE2__
+    __m128 vpx = _mm_set1_ps(px), vpy = _mm_set1_ps(py);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 xa = _mm_loadu_ps(&this->xa[i]), ya = _mm_loadu_ps(&this->ya[i]);
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&this->xb[i]), xa);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&this->yb[i]), ya);
+        __m128 len2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 dot = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(vpx, xa), dx), _mm_mul_ps(_mm_sub_ps(vpy, ya), dy));
+        __m128 valid = _mm_cmpgt_ps(len2, _mm_setzero_ps());
+        __m128 t = _mm_div_ps(dot, _mm_or_ps(len2, _mm_andnot_ps(valid, _mm_set1_ps(1))));
+
+        _mm_storeu_ps(&x[i], _mm_add_ps(xa, _mm_and_ps(_mm_mul_ps(t, dx), valid)));
+        _mm_storeu_ps(&y[i], _mm_or_ps(_mm_and_ps(_mm_add_ps(ya, _mm_mul_ps(t, dy)), valid), _mm_andnot_ps(valid, vpy)));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        float dx = this->xb[i] - this->xa[i];
+        float dy = this->yb[i] - this->ya[i];
+        float len2 = dx * dx + dy * dy;
+
+        if (len2 > 0)
+        {
+            float t = ((px - this->xa[i]) * dx + (py - this->ya[i]) * dy) / len2;
+            x[i] = this->xa[i] + t * dx;
+            y[i] = this->ya[i] + t * dy;
+        }
+        else
+        {
+            x[i] = this->xa[i];
+            y[i] = py;
+        }
+    }
+}
+
+// Nearest point to Point p inside every path, and its distance
+void PathStore::GetNearestPoints(Point p, float *x, float *y, float *distance)
+{
+    size_t n = GetSize(), i = 0;
+    float px = p.GetX(), py = p.GetY();
+
+#ifdef __SSE2__
+    __m128 vpx = _mm_set1_ps(px), vpy = _mm_set1_ps(py);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 vx, vy, d2;
+        Nearest4(vpx, vpy, _mm_loadu_ps(&this->xa[i]), _mm_loadu_ps(&this->ya[i]),
+                 _mm_loadu_ps(&this->xb[i]), _mm_loadu_ps(&this->yb[i]), vx, vy, d2);
+        _mm_storeu_ps(&x[i], vx);
+        _mm_storeu_ps(&y[i], vy);
+        _mm_storeu_ps(&distance[i], _mm_sqrt_ps(d2));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        float d2;
+        Nearest(px, py, this->xa[i], this->ya[i], this->xb[i], this->yb[i], x[i], y[i], d2);
+        distance[i] = sqrtf(d2);
+    }
+}
+
+// Find the path nearest to Point p. Return its index (GetSize() if the
+// store is empty), the nearest point inside it and the distance.
+size_t PathStore::GetNearest(Point p, Point &nearest, float &distance)
+{
+    size_t n = GetSize(), i = 0, best = n;
+    float px = p.GetX(), py = p.GetY();
+    float bestd2 = FLT_MAX;
+
+#ifdef __SSE2__
+    __m128 vpx = _mm_set1_ps(px), vpy = _mm_set1_ps(py);
+    __m128 mind2 = _mm_set1_ps(FLT_MAX);
+    __m128i minidx = _mm_setzero_si128();
+    __m128i idx = _mm_set_epi32(3, 2, 1, 0), four = _mm_set1_epi32(4);
+
+    // Keep the best path of each lane, then pick the best lane
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 vx, vy, d2;
+        Nearest4(vpx, vpy, _mm_loadu_ps(&this->xa[i]), _mm_loadu_ps(&this->ya[i]),
+                 _mm_loadu_ps(&this->xb[i]), _mm_loadu_ps(&this->yb[i]), vx, vy, d2);
+
+        __m128 better = _mm_cmplt_ps(d2, mind2);
+        mind2 = _mm_min_ps(d2, mind2);
+        minidx = _mm_or_si128(_mm_and_si128(_mm_castps_si128(better), idx), _mm_andnot_si128(_mm_castps_si128(better), minidx));
+        idx = _mm_add_epi32(idx, four);
+    }
+
+    if (i > 0)
+    {
+        float lane_d2[4];
+        int lane_idx[4];
+        _mm_storeu_ps(lane_d2, mind2);
+        _mm_storeu_si128((__m128i *)lane_idx, minidx);
+
+        for (unsigned int l = 0; l < 4; l++)
+        {
+            if ((lane_d2[l] < bestd2) || ((lane_d2[l] == bestd2) && ((size_t)lane_idx[l] < best)))
+            {
+                bestd2 = lane_d2[l];
+                best = lane_idx[l];
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        float x, y, d2;
+        Nearest(px, py, this->xa[i], this->ya[i], this->xb[i], this->yb[i], x, y, d2);
+        if (d2 < bestd2)
+        {
+            bestd2 = d2;
+            best = i;
+        }
+    }
+
+    if (best < n)
+    {
+        float x, y, d2;
+        Nearest(px, py, this->xa[best], this->ya[best], this->xb[best], this->yb[best], x, y, d2);
+        nearest = Point(x, y);
+        distance = sqrtf(d2);
+    }
+
+    return best;
+}
@@ -0,0 +1,406 @@
+/*
+ * PathSweep class implementation.
+ * Copyright (C) 2015-2018 João Paulo Just Peixoto <just1982@gmail.com>.
+ *
+ * This file is part of MobSink.
+ *
+ * MobSink is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MobSink is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MobSink.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PathSweep.h"
+#include <algorithm>
+#include <math.h>
+
+/* The sweep line moves from left to right (and from bottom to top along
+ * a vertical line). The status keeps the paths crossing the sweep line
+ * sorted from bottom to top, and only neighbours in the status can cross
+ * before the next event. At each event point p:
+ *
+ * - the paths through p (already in the status, next to each other) and
+ *   the paths starting at p are all reported as crossing each other,
+ *   unless p is an end point of both or the pair was already reported;
+ * - the paths through p are removed and the ones that go on past p are
+ *   inserted again with the new ones, sorted by their direction, which is
+ *   their order just after p (vertical paths come last);
+ * - the new neighbours are tested, and a crossing ahead of p becomes a
+ *   new event.
+ *
+ * The position of a vertical path in the status is the y of the event
+ * point, clamped to the path, so it moves up the sweep line with the
+ * events and always sits at the event it is handling.
+ */
+
+// Sign of the turn a -> b -> c (positive when counterclockwise). The
+// products are compared instead of subtracted, so the sign is exact for
+// float coordinates.
+static int Orientation(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    double left = (bx - ax) * (cy - ay);
+    double right = (by - ay) * (cx - ax);
+
+    return (left > right) ? 1 : ((left < right) ? -1 : 0);
+}
+
+// Constructor
+PathSweep::PathSweep(PathStore &paths)
+{
+    const float *xa = paths.GetXA();
+    const float *ya = paths.GetYA();
+    const float *xb = paths.GetXB();
+    const float *yb = paths.GetYB();
+    double size = 1;
+
+    this->segments.reserve(paths.GetSize());
+
+    for (size_t i = 0; i < paths.GetSize(); i++)
+    {
+        sweep_point a(xa[i], ya[i]), b(xb[i], yb[i]);
+        if (b < a)
+            swap(a, b);
+
+        size = max(size, max(max(fabs(a.first), fabs(a.second)), max(fabs(b.first), fabs(b.second))));
+
+        // A path without length has no place in the status
+        if (a == b)
+            continue;
+
+        sweep_segment segment = { a.first, a.second, b.first, b.second, (unsigned int)i };
+        this->segments.push_back(segment);
+    }
+
+    // Paths on the sweep line at the same time are kept close in memory
+    sort(this->segments.begin(), this->segments.end(), [](const sweep_segment &a, const sweep_segment &b)
+    {
+        return (a.xa != b.xa) ? (a.xa < b.xa) : ((a.ya != b.ya) ? (a.ya < b.ya) : (a.path < b.path));
+    });
+
+    this->active.assign(this->segments.size(), 0);
+    this->ends.reserve(this->segments.size() * 2);
+
+    for (size_t i = 0; i < this->segments.size(); i++)
+    {
+        const sweep_segment &segment = this->segments[i];
+        sweep_end start = { sweep_point(segment.xa, segment.ya), (unsigned int)i, true };
+        sweep_end end = { sweep_point(segment.xb, segment.yb), (unsigned int)i, false };
+        this->ends.push_back(start);
+        this->ends.push_back(end);
+    }
+
+    sort(this->ends.begin(), this->ends.end(), [](const sweep_end &a, const sweep_end &b) { return a.point < b.point; });
+    this->epsilon = PATHSWEEP_EPSILON * size;
+}
+
+// Find all the crossings
+void PathSweep::GetCrossings(vector<path_crossing> &result)
+{
+    result.clear();
+
+    // The events are the end points, in order, merged with the crossings
+    // found on the way
+    size_t next = 0;
+    while ((next < this->ends.size()) || !this->crossings.empty())
+    {
+        sweep_point p = (next < this->ends.size()) ? this->ends[next].point : this->crossings.top();
+        if (!this->crossings.empty() && (this->crossings.top() < p))
+            p = this->crossings.top();
+
+        while (!this->crossings.empty() && (this->crossings.top() == p))
+            this->crossings.pop();
+
+        this->starting.clear();
+        this->ending.clear();
+        for (; (next < this->ends.size()) && (this->ends[next].point == p); next++)
+            (this->ends[next].starting ? this->starting : this->ending).push_back(this->ends[next].segment);
+
+        HandleEvent(p, result);
+    }
+
+    this->status.clear();
+    this->reported.clear();
+}
+
+// Split the paths at their crossings. Each piece keeps the flow, name and
+// control parameters of its path, and the paths keep their order.
+void PathSweep::Split(PathStore &paths, vector<path_crossing> &crossings, PathStore &result)
+{
+    struct path_cut
+    {
+        unsigned int path;
+        float t;                // Position along the path
+        Point point;
+    };
+
+    vector<path_cut> cuts;
+    cuts.reserve(crossings.size() * 2);
+
+    for (size_t i = 0; i < crossings.size(); i++)
+    {
+        unsigned int ids[2] = { crossings[i].a, crossings[i].b };
+        for (unsigned int j = 0; j < 2; j++)
+        {
+            float xa = paths.GetXA()[ids[j]], ya = paths.GetYA()[ids[j]];
+            float dx = paths.GetXB()[ids[j]] - xa, dy = paths.GetYB()[ids[j]] - ya;
+            float len2 = dx * dx + dy * dy;
+
+            path_cut cut;
+            cut.path = ids[j];
+            cut.point = crossings[i].point;
+            cut.t = (len2 > 0) ? ((cut.point.GetX() - xa) * dx + (cut.point.GetY() - ya) * dy) / len2 : 0;
+            cuts.push_back(cut);
+        }
+    }
+
+    sort(cuts.begin(), cuts.end(), [](const path_cut &a, const path_cut &b)
+    {
+        return (a.path != b.path) ? (a.path < b.path) : (a.t < b.t);
+    });
+
+    result.Clear();
+    result.Reserve(paths.GetSize() + cuts.size());
+
+    size_t c = 0;
+    for (size_t i = 0; i < paths.GetSize(); i++)
+    {
+        Path path = paths.GetPath(i);
+        if ((c == cuts.size()) || (cuts[c].path != i))
+        {
+            result.Add(path);
+            continue;
+        }
+
+        // Pieces without length (repeated cuts or cuts at the end points) are left out
+        Point start = path.GetPointA();
+        Point end = path.GetPointB();
+
+        for (; (c < cuts.size()) && (cuts[c].path == i); c++)
+        {
+            if ((cuts[c].point == start) || (cuts[c].point == end))
+                continue;
+
+            Path piece = path;
+            piece.SetPointA(start);
+            piece.SetPointB(cuts[c].point);
+            result.Add(piece);
+            start = cuts[c].point;
+        }
+
+        Path piece = path;
+        piece.SetPointA(start);
+        piece.SetPointB(end);
+        result.Add(piece);
+    }
+}
+
+// Handle an event point
+void PathSweep::HandleEvent(const sweep_point &p, vector<path_crossing> &result)
+{
+    // The paths through p are next to each other in the status
+    size_t first = 0, last = this->status.size();
+    while (first < last)
+    {
+        size_t middle = first + (last - first) / 2;
+        if (GetY(this->status[middle], p) < p.second)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    while ((first > 0) && Contains(this->status[first - 1], p))
+        first--;
+
+    while ((last < this->status.size()) && Contains(this->status[last], p))
+        last++;
+
+    vector<unsigned int> &through = this->through;
+    through.assign(this->status.begin() + first, this->status.begin() + last);
+
+    for (size_t i = 0; i < through.size(); i++)
+        this->active[through[i]] = 0;
+
+    // A path ending here that was not found next to the others (the
+    // rounding of an earlier crossing moved it) is removed anyway
+    for (size_t i = 0; i < this->ending.size(); i++)
+    {
+        unsigned int s = this->ending[i];
+        if (!this->active[s])
+            continue;
+
+        size_t position = find(this->status.begin(), this->status.end(), s) - this->status.begin();
+        this->status.erase(this->status.begin() + position);
+        this->active[s] = 0;
+        through.push_back(s);
+
+        if (position < first)
+        {
+            first--;
+            last--;
+        }
+    }
+
+    // Every pair of paths meeting here crosses, unless both end here
+    vector<unsigned int> &group = through;
+    size_t found = through.size();
+    group.insert(group.end(), this->starting.begin(), this->starting.end());
+
+    for (size_t i = 0; i < group.size(); i++)
+    {
+        for (size_t j = i + 1; j < group.size(); j++)
+        {
+            if (IsEndPoint(group[i], p) && IsEndPoint(group[j], p))
+                continue;
+
+            path_crossing crossing;
+            crossing.a = min(this->segments[group[i]].path, this->segments[group[j]].path);
+            crossing.b = max(this->segments[group[i]].path, this->segments[group[j]].path);
+            crossing.point = Point(p.first, p.second);
+
+            // Overlapping paths meet again at every event along the
+            // overlap, and a crossing rounded back to p meets here again
+            // at its new event; only the first meeting is reported
+            if (!this->reported.insert(((unsigned long long)crossing.a << 32) | crossing.b).second)
+                continue;
+
+            result.push_back(crossing);
+        }
+    }
+
+    // Insert the paths that go on past p, in their order after p
+    vector<unsigned int> &inserted = this->inserted;
+    inserted.assign(this->starting.begin(), this->starting.end());
+    for (size_t i = 0; i < found; i++)
+    {
+        const sweep_segment &s = this->segments[through[i]];
+        if ((s.xb != p.first) || (s.yb != p.second))
+            inserted.push_back(through[i]);
+    }
+
+    sort(inserted.begin(), inserted.end(), [this](unsigned int s, unsigned int t) { return IsBelow(s, t); });
+
+    // They take the place of the paths through p, so the status only
+    // moves when the number of paths changes
+    size_t position = first;
+    if (inserted.size() > last - first)
+        this->status.insert(this->status.begin() + last, inserted.size() - (last - first), 0);
+    else
+        this->status.erase(this->status.begin() + first + inserted.size(), this->status.begin() + last);
+
+    copy(inserted.begin(), inserted.end(), this->status.begin() + position);
+
+    for (size_t i = 0; i < inserted.size(); i++)
+        this->active[inserted[i]] = 1;
+
+    // Test the new neighbours
+    if (inserted.empty())
+    {
+        if ((position > 0) && (position < this->status.size()))
+            CheckPair(position - 1, p);
+    }
+    else
+    {
+        if (position > 0)
+            CheckPair(position - 1, p);
+
+        if (position + inserted.size() < this->status.size())
+            CheckPair(position + inserted.size() - 1, p);
+    }
+}
+
+// Add the crossing of two neighbours in the status as an event, if it is
+// ahead of p. Paths that touch without crossing meet at an end point,
+// which is already an event.
+void PathSweep::CheckPair(size_t lower, const sweep_point &p)
+{
+    const sweep_segment &s = this->segments[this->status[lower]];
+    const sweep_segment &t = this->segments[this->status[lower + 1]];
+
+    if ((Orientation(s.xa, s.ya, s.xb, s.yb, t.xa, t.ya) * Orientation(s.xa, s.ya, s.xb, s.yb, t.xb, t.yb) >= 0) ||
+        (Orientation(t.xa, t.ya, t.xb, t.yb, s.xa, s.ya) * Orientation(t.xa, t.ya, t.xb, t.yb, s.xb, s.yb) >= 0))
+        return;
+
+    // The lower path must turn above the upper one, otherwise they already crossed
+    double sx = s.xb - s.xa, sy = s.yb - s.ya;
+    double tx = t.xb - t.xa, ty = t.yb - t.ya;
+    double cross = sx * ty - sy * tx;
+    if (cross >= 0)
+        return;
+
+    double u = ((t.xa - s.xa) * ty - (t.ya - s.ya) * tx) / cross;
+    sweep_point q(s.xa + u * sx, s.ya + u * sy);
+    q.first = min(max(q.first, max(s.xa, t.xa)), min(s.xb, t.xb));
+
+    // A crossing rounded back to p is handled right after it
+    if (!(p < q))
+    {
+        if ((fabs(q.first - p.first) > this->epsilon / 2) || (fabs(q.second - p.second) > this->epsilon / 2))
+            return;
+
+        q = sweep_point(p.first, nextafter(p.second, INFINITY));
+    }
+
+    this->crossings.push(q);
+}
+
+// Position of a path on the sweep line through p
+double PathSweep::GetY(unsigned int s, const sweep_point &p)
+{
+    const sweep_segment &segment = this->segments[s];
+
+    if (segment.xa == segment.xb)
+        return min(max(p.second, segment.ya), segment.yb);
+
+    if (p.first <= segment.xa)
+        return segment.ya;
+
+    if (p.first >= segment.xb)
+        return segment.yb;
+
+    double y = segment.ya + (p.first - segment.xa) * (segment.yb - segment.ya) / (segment.xb - segment.xa);
+    return min(max(y, min(segment.ya, segment.yb)), max(segment.ya, segment.yb));
+}
+
+// Return true if p is on the path
+bool PathSweep::Contains(unsigned int s, const sweep_point &p)
+{
+    if (IsEndPoint(s, p))
+        return true;
+
+    const sweep_segment &segment = this->segments[s];
+    double dx = segment.xb - segment.xa, dy = segment.yb - segment.ya;
+    double t = ((p.first - segment.xa) * dx + (p.second - segment.ya) * dy) / (dx * dx + dy * dy);
+    t = min(max(t, 0.0), 1.0);
+
+    double ex = p.first - (segment.xa + t * dx), ey = p.second - (segment.ya + t * dy);
+    return ex * ex + ey * ey <= this->epsilon * this->epsilon;
+}
+
+// Return true if p is an end point of the path
+bool PathSweep::IsEndPoint(unsigned int s, const sweep_point &p)
+{
+    const sweep_segment &segment = this->segments[s];
+    return ((segment.xa == p.first) && (segment.ya == p.second)) || ((segment.xb == p.first) && (segment.yb == p.second));
+}
+
+// Order of two paths leaving the same point (ties are broken by the path index)
+bool PathSweep::IsBelow(unsigned int s, unsigned int t)
+{
+    const sweep_segment &a = this->segments[s];
+    const sweep_segment &b = this->segments[t];
+    double left = (a.xb - a.xa) * (b.yb - b.ya);
+    double right = (a.yb - a.ya) * (b.xb - b.xa);
+
+    if (left != right)
+        return left > right;
+
+    return s < t;
+}
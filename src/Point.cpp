@@ -66,5 +66,7 @@ void Point::SetY(float y)
 // Return the distance between this Point and Point p
 float Point::Distance(Point p)
 {
-    return sqrtf(powf(abs(this->x - p.GetX()), 2) + powf(abs(this->y - p.GetY()), 2));
+    float dx = this->x - p.GetX();
+    float dy = this->y - p.GetY();
+    return sqrtf(dx * dx + dy * dy);
 }
@@ -0,0 +1,137 @@
+/*
+ * Map projection implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Projection.h>
+#include <algorithm>
+
+using namespace std;
+
+// Points taken along each side of the boundaries to find their extent
+#define PROJECTION_SIDE_STEPS 64
+
+// Constructor
+Projection::Projection()
+{
+	Setup(PROJECTION_EQUIRECTANGULAR, 0, 0, 0, 0, 0, 0);
+}
+
+// Set up the projection of the map boundaries to a network of the given size
+void Projection::Setup(projectiontype type, double minlat, double maxlat, double minlon, double maxlon, double width, double height)
+{
+	double right, bottom;
+	this->type = type;
+
+	switch (type)
+	{
+	case PROJECTION_MERCATOR:
+		SetupExtent(this->mercator, minlat, maxlat, minlon, maxlon, this->left, this->top, right, bottom);
+		break;
+	case PROJECTION_TRANSVERSE_MERCATOR:
+		SetupExtent(this->transverse, minlat, maxlat, minlon, maxlon, this->left, this->top, right, bottom);
+		break;
+	default:
+		SetupExtent(this->equirectangular, minlat, maxlat, minlon, maxlon, this->left, this->top, right, bottom);
+		break;
+	}
+
+	this->width = width;
+	this->height = height;
+	this->x_scale = (right > this->left) ? width / (right - this->left) : 0;
+	this->y_scale = (this->top > bottom) ? height / (this->top - bottom) : 0;
+}
+
+// Project a batch of nodes to network coordinates
+void Projection::Project(const node_location *locations, size_t count, float *x, float *y) const
+{
+	switch (this->type)
+	{
+	case PROJECTION_MERCATOR:
+		Run(this->mercator, locations, count, x, y);
+		break;
+	case PROJECTION_TRANSVERSE_MERCATOR:
+		Run(this->transverse, locations, count, x, y);
+		break;
+	default:
+		Run(this->equirectangular, locations, count, x, y);
+		break;
+	}
+}
+
+// Get the size in meters of the projected map boundaries
+void Projection::GetSize(projectiontype type, double minlat, double maxlat, double minlon, double maxlon, double &width, double &height)
+{
+	Projection projection;
+	projection.Setup(type, minlat, maxlat, minlon, maxlon, 1, 1);
+	width = (projection.x_scale > 0) ? 1 / projection.x_scale : 0;
+	height = (projection.y_scale > 0) ? 1 / projection.y_scale : 0;
+}
+
+// Center a projection on the map and find the extent of the projected
+// boundaries. The sides are not straight in every projection, so points
+// along them (and on the equator, where the map is widest) are projected.
+template <class P>
+void Projection::SetupExtent(P &projection, double minlat, double maxlat, double minlon, double maxlon,
+		double &left, double &top, double &right, double &bottom)
+{
+	projection.Setup((minlat + maxlat) / 2, (minlon + maxlon) / 2);
+
+	double x, y;
+	projection.Forward(minlat, minlon, x, y);
+	left = right = x;
+	top = bottom = y;
+
+	for (unsigned int i = 0; i <= PROJECTION_SIDE_STEPS; i++)
+	{
+		double lat = minlat + (maxlat - minlat) * i / PROJECTION_SIDE_STEPS;
+		double lon = minlon + (maxlon - minlon) * i / PROJECTION_SIDE_STEPS;
+		double side[5][2] = { { minlat, lon }, { maxlat, lon }, { lat, minlon }, { lat, maxlon }, { 0, minlon + maxlon - lon } };
+
+		for (unsigned int j = 0; j < 5; j++)
+		{
+			if ((side[j][0] < minlat) || (side[j][0] > maxlat))
+				continue;
+
+			projection.Forward(side[j][0], side[j][1], x, y);
+			left = min(left, x);
+			right = max(right, x);
+			bottom = min(bottom, y);
+			top = max(top, y);
+		}
+	}
+}
+
+// Projection kernel. Everything is done in double and only the results
+// are rounded to float. The nodes are kept in fixed point, so the ones on
+// the boundaries may land a rounding error away from the network; the
+// results are clamped to it.
+template <class P>
+void Projection::Run(const P &projection, const node_location *locations, size_t count, float *x, float *y) const
+{
+	const P p = projection;
+	const double left = this->left, top = this->top;
+	const double x_scale = this->x_scale, y_scale = this->y_scale;
+	const double width = this->width, height = this->height;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		double px, py;
+		p.Forward(locations[i].lat / NODEINDEX_SCALE, locations[i].lon / NODEINDEX_SCALE, px, py);
+		x[i] = min(max((px - left) * x_scale, 0.0), width);
+		y[i] = min(max((top - py) * y_scale, 0.0), height);
+	}
+}
@@ -0,0 +1,340 @@
+/*
+ * Road graph implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <RoadGraph.h>
+#include <algorithm>
+
+using namespace std;
+
+// Add the segments of a highway (ids are the nodes of each point)
+void RoadGraph::AddHighway(const highway &road, const vector<int64_t> &ids, const vector<Point> &points)
+{
+	uint32_t tags = GetRoad(road);
+
+	for (unsigned int i = 0; i < ids.size(); i++)
+	{
+		graph_node node;
+		node.id = ids[i];
+		node.point = points[i];
+		this->added.push_back(node);
+
+		// A node repeated right after itself is not a segment
+		if ((i == 0) || (ids[i - 1] == ids[i]))
+			continue;
+
+		graph_edge edge;
+		edge.a = 0;
+		edge.b = 0;
+		edge.road = tags;
+		edge.alive = true;
+		this->edges.push_back(edge);
+		this->edge_ids.push_back(ids[i - 1]);
+		this->edge_ids.push_back(ids[i]);
+	}
+}
+
+// Number the nodes and build the adjacency of each one
+void RoadGraph::Build(void)
+{
+	// The nodes are numbered in id order
+	stable_sort(this->added.begin(), this->added.end(),
+			[](const graph_node &a, const graph_node &b) { return a.id < b.id; });
+
+	this->ids.clear();
+	this->points.clear();
+	for (size_t i = 0; i < this->added.size(); i++)
+	{
+		if (!this->ids.empty() && (this->ids.back() == this->added[i].id))
+			continue;
+
+		this->ids.push_back(this->added[i].id);
+		this->points.push_back(this->added[i].point);
+	}
+
+	vector<graph_node>().swap(this->added);
+
+	for (size_t i = 0; i < this->edges.size(); i++)
+	{
+		this->edges[i].a = lower_bound(this->ids.begin(), this->ids.end(), this->edge_ids[2 * i]) - this->ids.begin();
+		this->edges[i].b = lower_bound(this->ids.begin(), this->ids.end(), this->edge_ids[2 * i + 1]) - this->ids.begin();
+	}
+
+	vector<int64_t>().swap(this->edge_ids);
+
+	// Count the edges of each node, then place them
+	this->first.assign(this->ids.size() + 1, 0);
+	for (size_t i = 0; i < this->edges.size(); i++)
+	{
+		this->first[this->edges[i].a + 1]++;
+		this->first[this->edges[i].b + 1]++;
+	}
+
+	for (size_t n = 0; n < this->ids.size(); n++)
+		this->first[n + 1] += this->first[n];
+
+	vector<uint32_t> next(this->first.begin(), this->first.end() - 1);
+	this->adjacency.resize(2 * this->edges.size());
+	for (size_t i = 0; i < this->edges.size(); i++)
+	{
+		this->adjacency[next[this->edges[i].a]++] = i;
+		this->adjacency[next[this->edges[i].b]++] = i;
+	}
+}
+
+// Remove the components with less than min_nodes nodes. Returns the number
+// of nodes removed.
+size_t RoadGraph::Prune(size_t min_nodes, size_t &components)
+{
+	// Union-find, with path halving and union by size
+	vector<uint32_t> parent(this->ids.size());
+	vector<uint32_t> size(this->ids.size(), 1);
+	for (size_t n = 0; n < parent.size(); n++)
+		parent[n] = n;
+
+	for (size_t i = 0; i < this->edges.size(); i++)
+	{
+		uint32_t a = Find(parent, this->edges[i].a);
+		uint32_t b = Find(parent, this->edges[i].b);
+		if (a == b)
+			continue;
+
+		if (size[a] < size[b])
+			swap(a, b);
+
+		parent[b] = a;
+		size[a] += size[b];
+	}
+
+	size_t removed = 0;
+	components = 0;
+	for (size_t n = 0; n < parent.size(); n++)
+	{
+		if ((parent[n] == n) && (size[n] < min_nodes))
+		{
+			components++;
+			removed += size[n];
+		}
+	}
+
+	for (size_t i = 0; i < this->edges.size(); i++)
+	{
+		if (size[Find(parent, this->edges[i].a)] < min_nodes)
+			this->edges[i].alive = false;
+	}
+
+	return removed;
+}
+
+// Merge the chains of nodes that only join two segments of the same
+// highway tags into single segments. The merged segment goes straight
+// from one end of the chain to the other. Returns the number of segments
+// removed.
+size_t RoadGraph::Contract(void)
+{
+	// The chains are found first and merged afterwards, so that the
+	// adjacency still matches the segments while they are walked
+	vector<char> visited(this->edges.size(), 0);
+	vector<uint32_t> kept;
+	vector<graph_edge> merged;
+	vector<uint32_t> removed;
+
+	for (uint32_t x = 0; x < this->ids.size(); x++)
+	{
+		uint32_t in, out;
+		if (IsChainNode(x, in, out))
+			continue;
+
+		// Follow each segment of a junction (or dead end) to the next one
+		for (uint32_t j = this->first[x]; j < this->first[x + 1]; j++)
+		{
+			uint32_t e = this->adjacency[j];
+			if (!this->edges[e].alive || visited[e])
+				continue;
+
+			vector<uint32_t> chain(1, e);
+			visited[e] = 1;
+			uint32_t node = (this->edges[e].a == x) ? this->edges[e].b : this->edges[e].a;
+
+			while ((node != x) && IsChainNode(node, in, out))
+			{
+				e = (in == e) ? out : in;
+				if (visited[e])
+					break;
+
+				chain.push_back(e);
+				visited[e] = 1;
+				node = (this->edges[e].a == node) ? this->edges[e].b : this->edges[e].a;
+			}
+
+			// A chain that comes back to where it started is kept, since it
+			// would become a segment of length zero
+			if ((chain.size() < 2) || (node == x))
+				continue;
+
+			// The merged segment takes the place of the first of the chain,
+			// in the direction of the first segment walked
+			uint32_t lowest = *min_element(chain.begin(), chain.end());
+			bool forward = this->edges[chain[0]].a == x;
+			graph_edge edge = this->edges[lowest];
+			edge.a = forward ? x : node;
+			edge.b = forward ? node : x;
+			kept.push_back(lowest);
+			merged.push_back(edge);
+
+			for (size_t i = 0; i < chain.size(); i++)
+			{
+				if (chain[i] != lowest)
+					removed.push_back(chain[i]);
+			}
+		}
+	}
+
+	// Chains that are closed loops with no junction are left as they are.
+	// The adjacency is not updated: it is only used to find the chains.
+	for (size_t i = 0; i < kept.size(); i++)
+		this->edges[kept[i]] = merged[i];
+
+	for (size_t i = 0; i < removed.size(); i++)
+		this->edges[removed[i]].alive = false;
+
+	return removed.size();
+}
+
+// Write the segments left as paths, in the order they were added
+void RoadGraph::Write(NetworkBuilder &builder)
+{
+	vector<Point> segment(2);
+	for (size_t i = 0; i < this->edges.size(); i++)
+	{
+		const graph_edge &edge = this->edges[i];
+		if (!edge.alive)
+			continue;
+
+		segment[0] = this->points[edge.a];
+		segment[1] = this->points[edge.b];
+		builder.WriteHighway(this->roads[edge.road], segment);
+	}
+}
+
+// Remove everything
+void RoadGraph::Clear(void)
+{
+	vector<graph_node>().swap(this->added);
+	vector<int64_t>().swap(this->edge_ids);
+	vector<int64_t>().swap(this->ids);
+	vector<Point>().swap(this->points);
+	vector<graph_edge>().swap(this->edges);
+	vector<uint32_t>().swap(this->first);
+	vector<uint32_t>().swap(this->adjacency);
+	this->roads.clear();
+	this->road_ids.clear();
+}
+
+// Return the number of nodes that still have segments
+size_t RoadGraph::GetNodeCount(void)
+{
+	size_t count = 0;
+	vector<char> used(this->ids.size(), 0);
+	for (size_t i = 0; i < this->edges.size(); i++)
+	{
+		if (!this->edges[i].alive)
+			continue;
+
+		count += !used[this->edges[i].a] + !used[this->edges[i].b];
+		used[this->edges[i].a] = 1;
+		used[this->edges[i].b] = 1;
+	}
+
+	return count;
+}
+
+// Return the number of segments left
+size_t RoadGraph::GetEdgeCount(void)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < this->edges.size(); i++)
+		count += this->edges[i].alive;
+
+	return count;
+}
+
+// Find the component of a node
+uint32_t RoadGraph::Find(vector<uint32_t> &parent, uint32_t n)
+{
+	while (parent[n] != n)
+	{
+		parent[n] = parent[parent[n]];
+		n = parent[n];
+	}
+
+	return n;
+}
+
+// Return true if a node is in the middle of a chain: it has exactly two
+// segments, with the same tags, and one-way segments follow each other.
+// in and out are its two segments (in enters the node on one-way roads).
+bool RoadGraph::IsChainNode(uint32_t n, uint32_t &in, uint32_t &out)
+{
+	unsigned int count = 0;
+	uint32_t found[2];
+
+	for (uint32_t j = this->first[n]; j < this->first[n + 1]; j++)
+	{
+		uint32_t e = this->adjacency[j];
+		if (!this->edges[e].alive)
+			continue;
+
+		if (count == 2)
+			return false;
+
+		found[count++] = e;
+	}
+
+	if ((count != 2) || (this->edges[found[0]].road != this->edges[found[1]].road))
+		return false;
+
+	in = found[0];
+	out = found[1];
+	if (this->roads[this->edges[in].road].flow != PATHFLOW_AB)
+		return true;
+
+	if (this->edges[in].b != n)
+		swap(in, out);
+
+	return (this->edges[in].b == n) && (this->edges[out].a == n);
+}
+
+// Return the index of the tags of a highway, adding them if they are new
+uint32_t RoadGraph::GetRoad(const highway &road)
+{
+	pair<pair<string, int>, float> key(make_pair(road.name, (int)road.flow), road.speedlimit);
+	map<pair<pair<string, int>, float>, uint32_t>::iterator it = this->road_ids.find(key);
+	if (it != this->road_ids.end())
+		return it->second;
+
+	highway tags;
+	tags.id = road.id;
+	tags.name = road.name;
+	tags.flow = road.flow;
+	tags.speedlimit = road.speedlimit;
+
+	uint32_t index = this->roads.size();
+	this->roads.push_back(tags);
+	this->road_ids[key] = index;
+	return index;
+}
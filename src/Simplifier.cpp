@@ -0,0 +1,169 @@
+/*
+ * Way simplification implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Simplifier.h>
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+// Distance between Point p and the segment ab
+static double SegmentDistance(Point p, Point a, Point b)
+{
+	double dx = (double)b.GetX() - a.GetX();
+	double dy = (double)b.GetY() - a.GetY();
+	double px = (double)p.GetX() - a.GetX();
+	double py = (double)p.GetY() - a.GetY();
+	double length = dx * dx + dy * dy;
+
+	if (length > 0)
+	{
+		double t = (px * dx + py * dy) / length;
+		t = t < 0 ? 0 : (t > 1 ? 1 : t);
+		px -= t * dx;
+		py -= t * dy;
+	}
+
+	return sqrt(px * px + py * py);
+}
+
+// Constructor
+Simplifier::Simplifier(float tolerance)
+{
+	this->tolerance = tolerance;
+	this->segments = 0;
+	this->removed = 0;
+}
+
+// Count the nodes of a way that will be simplified later
+void Simplifier::AddWay(const vector<int64_t> &refs)
+{
+	this->refs.insert(this->refs.end(), refs.begin(), refs.end());
+}
+
+// Find the nodes used more than once. Must be called after all ways were added.
+void Simplifier::Prepare(void)
+{
+	sort(this->refs.begin(), this->refs.end());
+
+	for (size_t i = 1; i < this->refs.size(); i++)
+	{
+		if ((this->refs[i] == this->refs[i - 1]) && ((i == 1) || (this->refs[i] != this->refs[i - 2])))
+			this->shared.Insert(this->refs[i]);
+	}
+
+	vector<int64_t>().swap(this->refs);
+
+	// Sort the set now, so that looking it up doesn't change it
+	this->shared.GetSize();
+}
+
+// Simplify the points of a way (ids are the nodes of each point)
+void Simplifier::Simplify(vector<int64_t> &ids, vector<Point> &points)
+{
+	size_t n = points.size();
+	if (n < 2)
+		return;
+
+	this->segments += n - 1;
+	if (n < 3)
+		return;
+
+	// Points that must stay
+	vector<bool> keep(n, false);
+	keep[0] = keep[n - 1] = true;
+
+	for (size_t i = 1; i < n - 1; i++)
+	{
+		if (this->shared.Contains(ids[i]))
+			keep[i] = true;
+	}
+
+	// Simplify each stretch between them
+	size_t first = 0;
+	for (size_t i = 1; i < n; i++)
+	{
+		if (keep[i])
+		{
+			Reduce(points, keep, first, i);
+			first = i;
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (keep[i])
+		{
+			ids[kept] = ids[i];
+			points[kept] = points[i];
+			kept++;
+		}
+	}
+
+	ids.resize(kept);
+	points.resize(kept);
+	this->removed += n - kept;
+}
+
+// Return the number of segments seen
+unsigned long Simplifier::GetSegments(void)
+{
+	return this->segments;
+}
+
+// Return the number of segments removed
+unsigned long Simplifier::GetRemoved(void)
+{
+	return this->removed;
+}
+
+// Douglas-Peucker: keep the farthest point from the segment first-last if it
+// is beyond the tolerance, then do the same on both sides of it
+void Simplifier::Reduce(vector<Point> &points, vector<bool> &keep, size_t first, size_t last)
+{
+	vector<pair<size_t, size_t> > stretches;
+	stretches.push_back(make_pair(first, last));
+
+	while (!stretches.empty())
+	{
+		first = stretches.back().first;
+		last = stretches.back().second;
+		stretches.pop_back();
+
+		double farthest = 0;
+		size_t index = 0;
+
+		for (size_t i = first + 1; i < last; i++)
+		{
+			double distance = SegmentDistance(points[i], points[first], points[last]);
+			if (distance > farthest)
+			{
+				farthest = distance;
+				index = i;
+			}
+		}
+
+		if (farthest > this->tolerance)
+		{
+			keep[index] = true;
+			stretches.push_back(make_pair(first, index));
+			stretches.push_back(make_pair(index, last));
+		}
+	}
+}
@@ -0,0 +1,175 @@
+/*
+ * Slim mode store implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <SlimStore.h>
+#include <BinaryIO.h>
+#include <string>
+
+using namespace std;
+
+// Constructor. The files are named after the prefix. The nodes waiting to
+// be written get a quarter of the memory and each sort half of it, which
+// is never used by more than two of them at once.
+SlimStore::SlimStore(const string &prefix, size_t memory):
+	refs(prefix + ".refs", memory / 2),
+	found(prefix + ".found", memory / 2)
+{
+	this->prefix = prefix;
+	this->highways = NULL;
+	this->memory = memory;
+	this->count = 0;
+	this->ok = false;
+}
+
+// Destructor
+SlimStore::~SlimStore()
+{
+	Close();
+}
+
+// Create the files
+bool SlimStore::Open(void)
+{
+	Close();
+
+	if (this->nodes.Open(this->prefix + ".nodes", this->memory / 4))
+		this->highways = fopen((this->prefix + ".ways").c_str(), "w+b");
+
+	this->ok = this->highways != NULL;
+	return this->ok;
+}
+
+// Keep a node
+void SlimStore::AddNode(int64_t id, double lat, double lon)
+{
+	this->nodes.Insert(id, lat, lon);
+}
+
+// Keep a highway. The references are sorted apart from the rest.
+void SlimStore::AddHighway(const highway &road)
+{
+	FILE *fp = this->highways;
+	if (!BinaryPut(fp, road.id) || !BinaryPut(fp, (uint8_t)road.flow) || !BinaryPut(fp, road.speedlimit) ||
+		!BinaryPutArray(fp, road.name.data(), road.name.size()))
+		this->ok = false;
+
+	slim_ref ref;
+	ref.way = this->count++;
+	for (size_t i = 0; i < road.refs.size(); i++)
+	{
+		ref.id = road.refs[i];
+		ref.position = i;
+		this->refs.Add(ref);
+	}
+}
+
+// Find the nodes of the highways and call visit(road, locations) for each
+// highway with nodes, in the order they were added. The references to
+// nodes that were not found are counted in missing.
+bool SlimStore::ForEach(highway_function visit, unsigned long long &missing)
+{
+	if (!this->ok || !this->nodes.Finish())
+		return false;
+
+	// Join the references with the nodes, in node id order
+	bool ok = this->refs.ForEach([this, &missing](const slim_ref &ref)
+	{
+		slim_node node;
+		if (!this->nodes.Find(ref.id, node.location))
+		{
+			missing++;
+			return;
+		}
+
+		node.way = ref.way;
+		node.position = ref.position;
+		this->found.Add(node);
+	});
+
+	this->nodes.Close();
+	if (!ok || (fseek(this->highways, 0, SEEK_SET) != 0))
+		return false;
+
+	// Put the nodes back into the highways. The highways without any node
+	// found are skipped.
+	highway road;
+	uint32_t current = 0, next = 0;         // Highway being built and the next one in the file
+	bool started = false;
+	vector<node_location> locations;
+
+	ok = this->found.ForEach([&](const slim_node &node)
+	{
+		if (started && (node.way == current))
+		{
+			locations.push_back(node.location);
+			return;
+		}
+
+		if (started && this->ok)
+			visit(road, locations);
+
+		// Skip to the highway of the node
+		while (this->ok && (next <= node.way))
+		{
+			this->ok = ReadHighway(road);
+			next++;
+		}
+
+		current = node.way;
+		started = true;
+		locations.assign(1, node.location);
+	});
+
+	if (started && ok && this->ok)
+		visit(road, locations);
+
+	return ok && this->ok;
+}
+
+// Remove the files
+void SlimStore::Close(void)
+{
+	this->nodes.Close();
+	this->refs.Clear();
+	this->found.Clear();
+
+	if (this->highways)
+	{
+		fclose(this->highways);
+		this->highways = NULL;
+		remove((this->prefix + ".ways").c_str());
+	}
+
+	this->count = 0;
+	this->ok = false;
+}
+
+// Read the next highway
+bool SlimStore::ReadHighway(highway &road)
+{
+	FILE *fp = this->highways;
+	uint8_t flow;
+	vector<char> name;
+
+	if (!BinaryGet(fp, road.id) || !BinaryGet(fp, flow) || !BinaryGet(fp, road.speedlimit) || !BinaryGetArray(fp, name))
+		return false;
+
+	road.flow = (pathflow)flow;
+	road.name.assign(name.data(), name.size());
+	return true;
+}
@@ -0,0 +1,263 @@
+/*
+ * Highway tag rules implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <TagRules.h>
+#include <ParseCache.h>
+#include <algorithm>
+#include <functional>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+// Constructor (the default rules)
+TagRules::TagRules()
+{
+	Clear();
+	this->any_class = true;
+	this->oneways["yes"] = false;
+}
+
+// Remove all the rules
+void TagRules::Clear(void)
+{
+	this->key = 0;
+	this->keys.clear();
+	this->keys["highway"] = TAG_HIGHWAY;
+	this->keys["oneway"] = TAG_ONEWAY;
+	this->keys["maxspeed"] = TAG_MAXSPEED;
+	this->keys["name"] = TAG_NAME;
+	this->classes.clear();
+	this->any_class = false;
+	this->any_speed = 0;
+	this->oneways.clear();
+	this->units.clear();
+}
+
+// Read the rules from a file, replacing the default ones
+bool TagRules::Load(const string &filename)
+{
+	FILE *fp = fopen(filename.c_str(), "r");
+	string text;
+	if (!fp || !ReadAll(fp, text))
+	{
+		printf("The rules file %s could not be opened.\n", filename.c_str());
+		if (fp)
+			fclose(fp);
+
+		return false;
+	}
+
+	if (!Parse(text, "file " + filename))
+	{
+		fclose(fp);
+		return false;
+	}
+
+	// The rules are part of what was read, so they are part of the cache key
+	fseek(fp, 0, SEEK_SET);
+	this->key = ParseCache::Hash(fp);
+	fclose(fp);
+	return true;
+}
+
+// Set the rules from a text in the format of the rules file, replacing
+// the default ones. Programs converting maps in memory don't need a file.
+bool TagRules::Set(const string &rules)
+{
+	if (!Parse(rules, "text"))
+		return false;
+
+	this->key = hash<string>()(rules) | 1;
+	return true;
+}
+
+// Read a whole file
+bool TagRules::ReadAll(FILE *fp, string &text)
+{
+	char buffer[4096];
+	size_t size;
+	while ((size = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		text.append(buffer, size);
+
+	return !ferror(fp);
+}
+
+// Compile the rules of a text, one per line. The source names the text in
+// the error messages.
+bool TagRules::Parse(const string &text, const string &source)
+{
+	Clear();
+	unsigned int number = 0;
+
+	for (size_t start = 0; start < text.size(); )
+	{
+		size_t end = text.find('\n', start);
+		if (end == string::npos)
+			end = text.size();
+
+		string line = text.substr(start, end - start);
+		start = end + 1;
+		number++;
+
+		// Split the fields (without strtok(), which keeps its position in
+		// a global, so the rules can be set by any thread)
+		vector<string> fields;
+		line.resize(strcspn(line.c_str(), "\r"));
+		for (size_t field = line.find_first_not_of(" \t"); field != string::npos; )
+		{
+			size_t field_end = line.find_first_of(" \t", field);
+			fields.push_back(line.substr(field, field_end - field));
+			field = line.find_first_not_of(" \t", field_end);
+		}
+
+		if (fields.empty() || (fields[0][0] == '#'))
+			continue;
+
+		bool ok = false;
+		if ((fields[0] == "highway") && (fields.size() >= 2) && (fields.size() <= 3))
+		{
+			float speed = (fields.size() == 3) ? atof(fields[2].c_str()) : 0;
+			ok = speed >= 0;
+
+			if (fields[1] == "*")
+			{
+				this->any_class = true;
+				this->any_speed = speed;
+			}
+			else
+				this->classes[fields[1]] = speed;
+		}
+		else if ((fields[0] == "oneway") && (fields.size() == 3) && ((fields[2] == "forward") || (fields[2] == "reverse")))
+		{
+			this->oneways[fields[1]] = (fields[2] == "reverse");
+			ok = true;
+		}
+		else if ((fields[0] == "maxspeed") && (fields.size() == 3))
+		{
+			float factor = atof(fields[2].c_str());
+			this->units.push_back(make_pair(fields[1], factor));
+			ok = factor > 0;
+		}
+
+		if (!ok)
+		{
+			printf("Line %u of the rules %s is not valid.\n", number, source.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Read the attributes of a highway from the tags of a way. Returns false
+// if the way is not a highway or its class is not kept.
+bool TagRules::ParseHighway(const osm_way &way, highway &road) const
+{
+	bool insert_way = false;
+	float class_speed = 0;
+	const string *name = NULL;
+	bool reverse = false;
+
+	road.id = way.id;
+	road.flow = PATHFLOW_BI;
+	road.speedlimit = 0;
+
+	// Tags
+	for (unsigned int i = 0; i < way.tags.size(); i++)
+	{
+		const osm_tag &tag = way.tags[i];
+		unordered_map<string, tagkind>::const_iterator kind = this->keys.find(tag.key);
+		if (kind == this->keys.end())
+			continue;
+
+		switch (kind->second)
+		{
+		// Only insert a way if it is a highway of a kept class
+		case TAG_HIGHWAY:
+		{
+			unordered_map<string, float>::const_iterator it = this->classes.find(tag.value);
+			if ((it == this->classes.end()) && !this->any_class)
+				return false;
+
+			insert_way = true;
+			class_speed = (it == this->classes.end()) ? this->any_speed : it->second;
+			break;
+		}
+
+		// Is this an one-way road?
+		case TAG_ONEWAY:
+		{
+			unordered_map<string, bool>::const_iterator it = this->oneways.find(tag.value);
+			if (it != this->oneways.end())
+			{
+				road.flow = PATHFLOW_AB;
+				reverse = it->second;
+			}
+			break;
+		}
+
+		// Does it have a speed limit?
+		case TAG_MAXSPEED:
+			road.speedlimit = ParseSpeed(tag.value);
+			break;
+
+		// Does it have a name?
+		case TAG_NAME:
+			name = &tag.value;
+			break;
+		}
+	}
+
+	if (!insert_way)
+		return false;
+
+	if (road.speedlimit <= 0)
+		road.speedlimit = class_speed;
+
+	road.name = name ? *name : string();
+	road.refs = way.refs;
+
+	// One-way roads always go from the first node to the last one
+	if (reverse)
+		std::reverse(road.refs.begin(), road.refs.end());
+
+	return true;
+}
+
+// Read a maxspeed value in km/h. Values in other units end with the unit,
+// like "30 mph".
+float TagRules::ParseSpeed(const string &value) const
+{
+	const char *text = value.c_str();
+	char *end;
+	float speed = strtod(text, &end);
+	if (end == text)
+		return 0;
+
+	while (*end == ' ')
+		end++;
+
+	for (size_t i = 0; i < this->units.size(); i++)
+	{
+		if (this->units[i].first == end)
+			return speed * this->units[i].second;
+	}
+
+	return speed;
+}
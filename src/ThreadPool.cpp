@@ -0,0 +1,170 @@
+/*
+ * Thread pool implementation.
+ * Copyright (C) 2017 - 2018 João Paulo Just Peixoto <just1982@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ThreadPool.h>
+
+using namespace std;
+
+// The pool and worker index of the current thread
+static thread_local ThreadPool *current_pool = NULL;
+static thread_local unsigned int current_worker = 0;
+
+// Constructor (0 threads means one per CPU core)
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	this->pending = 0;
+	this->unfinished = 0;
+	this->stop = false;
+
+	if (threads == 0)
+		threads = GetDefaultSize();
+
+	for (unsigned int i = 0; i < threads; i++)
+		this->queues.push_back(unique_ptr<worker_queue>(new worker_queue));
+
+	for (unsigned int i = 0; i < threads; i++)
+		this->workers.push_back(thread(&ThreadPool::Run, this, i));
+}
+
+// Destructor: finish the pending tasks and stop the workers
+ThreadPool::~ThreadPool()
+{
+	{
+		unique_lock<mutex> guard(this->lock);
+		this->stop = true;
+	}
+
+	this->task_ready.notify_all();
+	for (unsigned int i = 0; i < this->workers.size(); i++)
+		this->workers[i].join();
+}
+
+// Return the number of worker threads
+unsigned int ThreadPool::GetSize(void)
+{
+	return this->workers.size();
+}
+
+// Return the number of CPU cores (at least 1)
+unsigned int ThreadPool::GetDefaultSize(void)
+{
+	unsigned int cores = thread::hardware_concurrency();
+	return cores > 0 ? cores : 1;
+}
+
+// Queue a task. A task submitted by one of the workers stays with it.
+void ThreadPool::Submit(function<void()> task)
+{
+	{
+		unique_lock<mutex> guard(this->lock);
+		this->pending++;
+		this->unfinished++;
+
+		if (current_pool != this)
+			this->tasks.push_back(task);
+	}
+
+	if (current_pool == this)
+	{
+		worker_queue &queue = *this->queues[current_worker];
+		unique_lock<mutex> guard(queue.lock);
+		queue.tasks.push_back(task);
+	}
+
+	this->task_ready.notify_one();
+}
+
+// Wait until all the submitted tasks are finished
+void ThreadPool::Wait(void)
+{
+	unique_lock<mutex> guard(this->lock);
+	while (this->unfinished > 0)
+		this->task_done.wait(guard);
+}
+
+// Take the next task of a worker: its own newest task, the oldest task of
+// another worker or the oldest task submitted from outside, in this order
+bool ThreadPool::Take(unsigned int index, function<void()> &task)
+{
+	{
+		worker_queue &queue = *this->queues[index];
+		unique_lock<mutex> guard(queue.lock);
+		if (!queue.tasks.empty())
+		{
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			this->pending--;
+			return true;
+		}
+	}
+
+	for (unsigned int i = 1; i < this->queues.size(); i++)
+	{
+		worker_queue &queue = *this->queues[(index + i) % this->queues.size()];
+		unique_lock<mutex> guard(queue.lock);
+		if (!queue.tasks.empty())
+		{
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			this->pending--;
+			return true;
+		}
+	}
+
+	unique_lock<mutex> guard(this->lock);
+	if (this->tasks.empty())
+		return false;
+
+	task = this->tasks.front();
+	this->tasks.pop_front();
+	this->pending--;
+	return true;
+}
+
+// Worker loop
+void ThreadPool::Run(unsigned int index)
+{
+	current_pool = this;
+	current_worker = index;
+
+	while (true)
+	{
+		function<void()> task;
+
+		if (!Take(index, task))
+		{
+			unique_lock<mutex> guard(this->lock);
+			while (!this->stop && (this->pending == 0))
+				this->task_ready.wait(guard);
+
+			if (this->stop && (this->pending == 0))
+				return;
+
+			continue;
+		}
+
+		task();
+
+		{
+			unique_lock<mutex> guard(this->lock);
+			this->unfinished--;
+		}
+
+		this->task_done.notify_all();
+	}
+}